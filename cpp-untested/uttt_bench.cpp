@@ -0,0 +1,49 @@
+/*******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 Abdulla Gaibullaev
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ ******************************************************************************/
+
+#include "uttt_engine.h"
+
+/**
+ * Speed of the engine, and the training run of the profile-guided build.
+ *
+ *      uttt_bench [depth] [features]       nodes and speed of the search on the benchmark positions
+ *      uttt_bench smp [depth]              time to depth of the parallel search
+ */
+
+int main(int argc, char **argv) {
+    initEngine();
+
+    if (argc > 1 && std::string(argv[1]) == "smp") {
+        smpBench(argc > 2 ? stringToInt(argv[2]) : BENCH_DEPTH);
+        return 0;
+    }
+
+    if (argc > 2 && (searchFeatures = parseFeatures(argv[2])) < 0) {
+        std::cerr << "unknown search feature in " << argv[2] << std::endl;
+        return 1;
+    }
+
+    bench(argc > 1 ? stringToInt(argv[1]) : BENCH_DEPTH);
+    return 0;
+}
@@ -0,0 +1,201 @@
+/*******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 Abdulla Gaibullaev
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ ******************************************************************************/
+
+#include "uttt_engine.h"
+
+#include <unordered_map>
+#include <unordered_set>
+
+/**
+ * Offline generator of the opening book.
+ *
+ *      uttt_book [-plies N] [-depth D] [-threads T] [-hash MB] [-out file]
+ *
+ * For each side, the book follows its own book move and every answer of the
+ * opponent, for the first N plies. The positions of one ply are searched in
+ * parallel, one position per thread, each with its own table.
+ */
+
+
+//  a position of the book tree, and the side the book plays in it
+struct BookNode {
+    Position position;
+    int side;
+};
+
+struct BookOptions {
+    int plies;
+    int depth;
+    int threads;
+    int hashMb;
+    std::string out;
+};
+
+//  fixed-depth searches of positions, shared out between the threads
+void searchPositions(const std::vector<Position> &positions, const BookOptions &options,
+                     std::vector<BookEntry> &entries) {
+    std::atomic<size_t> next(0);
+    size_t first = entries.size();
+
+    entries.resize(first + positions.size());
+
+    auto worker = [&]() {
+        TranspositionTable tt;
+        tt.resize(options.hashMb);
+
+        for (size_t i = next++; i < positions.size(); i = next++) {
+            const Position &position = positions[i];
+            int player = position.sideToMove();
+            _score_t score;
+            long nodes;
+
+            tt.clear();
+            tt.newSearch();
+            int best = parallelThink(position, player, &tt, 1, std::min(options.depth, position.emptyCells()),
+                                     _time_t::max(), score, nodes);
+
+            BookEntry &entry = entries[first + i];
+            entry.key = position.hash;
+            entry.score = (__int32_t) std::max<_score_t>(INT32_MIN, std::min<_score_t>(INT32_MAX, score));
+            entry.move = (__uint8_t) best;
+            entry.depth = (__uint8_t) options.depth;
+            entry.reserved = 0;
+        }
+    };
+
+    std::vector<std::thread> helpers;
+
+    for (int i = 1; i < options.threads; i++)
+        helpers.push_back(std::thread(worker));
+
+    worker();
+
+    for (std::thread &helper : helpers)
+        helper.join();
+}
+
+void generateBook(const BookOptions &options) {
+    std::vector<BookEntry> entries;
+    std::vector<BookNode> layer;
+    std::unordered_set<__uint64_t> searched;
+
+    for (int side = 1; side <= 2; side++) {
+        BookNode start;
+        start.position.clear();
+        start.side = side;
+        layer.push_back(start);
+    }
+
+    for (int ply = 0; ply < options.plies && !layer.empty(); ply++) {
+        _time_t start = _clock_t::now();
+
+        //  the book side's positions: searched once, even when both trees reach them
+        std::vector<Position> positions;
+
+        for (const BookNode &node : layer) {
+            if (node.position.sideToMove() == node.side && searched.insert(node.position.hash).second)
+                positions.push_back(node.position);
+        }
+
+        size_t first = entries.size();
+        searchPositions(positions, options, entries);
+
+        std::unordered_map<__uint64_t, int> bookMoves;
+        for (size_t i = first; i < entries.size(); i++)
+            bookMoves[entries[i].key] = entries[i].move;
+
+        //  the book move where the book plays, every move where the opponent does
+        std::vector<BookNode> nextLayer;
+        std::unordered_set<__uint64_t> seen[2];
+
+        for (const BookNode &node : layer) {
+            _mask81_t moves = node.position.getAvailableMoves();
+
+            if (node.position.sideToMove() == node.side) {
+                auto book = bookMoves.find(node.position.hash);
+                moves = (book != bookMoves.end()) ? (cellMask(book->second)) : (0);
+            }
+
+            while (moves) {
+                BookNode child = node;
+                child.position.simulateMove(popCell(moves), node.position.sideToMove());
+
+                if (!child.position.gameIsFinished() && seen[node.side - 1].insert(child.position.hash).second)
+                    nextLayer.push_back(child);
+            }
+        }
+
+        layer.swap(nextLayer);
+
+        std::cout << "ply " << ply << ": " << positions.size() << " positions searched in "
+                  << std::chrono::duration_cast<std::chrono::milliseconds>(_clock_t::now() - start).count()
+                  << " ms" << std::endl;
+    }
+
+    if (OpeningBook::write(options.out, entries))
+        std::cout << entries.size() << " positions written to " << options.out << std::endl;
+    else
+        std::cout << "cannot write " << options.out << std::endl;
+}
+
+
+int main(int argc, char **argv) {
+    initEngine();
+
+    BookOptions options;
+    options.plies = 4;
+    options.depth = 10;
+    options.threads = std::max(1, (int) std::thread::hardware_concurrency());
+    options.hashMb = DEFAULT_HASH_MB;
+    options.out = DEFAULT_BOOK;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool more = i + 1 < argc;
+
+        if (arg == "-plies" && more) {
+            options.plies = stringToInt(argv[++i]);
+        }
+        else if (arg == "-depth" && more) {
+            options.depth = std::max(1, stringToInt(argv[++i]));
+        }
+        else if (arg == "-threads" && more) {
+            options.threads = std::max(1, stringToInt(argv[++i]));
+        }
+        else if (arg == "-hash" && more) {
+            options.hashMb = stringToInt(argv[++i]);
+        }
+        else if (arg == "-out" && more) {
+            options.out = argv[++i];
+        }
+        else {
+            std::cerr << "unknown option " << arg << std::endl;
+            return 1;
+        }
+    }
+
+    generateBook(options);
+
+    return 0;
+}
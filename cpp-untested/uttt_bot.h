@@ -0,0 +1,596 @@
+/*******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 Abdulla Gaibullaev
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ ******************************************************************************/
+
+#ifndef UTTT_BOT_H
+#define UTTT_BOT_H
+
+#include "uttt_engine.h"
+
+#include <fstream>
+
+//  defaults of the solver thresholds
+const int SOLVER_EMPTY = 36;
+const int SOLVER_SQUARES = 4;
+
+//  the longest command has four words
+const int MAX_TOKENS = 8;
+
+enum _engine_t {
+    ENGINE_MINIMAX, ENGINE_MCTS
+};
+
+
+/**
+ * This class implements all IO operations.
+ * Only one method must be realized:
+ *
+ *      > Bot::action
+ *
+ */
+class Bot {
+
+public:
+
+    /**
+     * Initialize your bot here.
+     */
+    Bot() {
+        srand(static_cast<unsigned int>(time(0)));
+        initEngine();
+        _position.clear();
+        _round = 0;
+        _move = 0;
+
+        _timebank = 10000;
+        _timePerMove = 500;
+        _threads = 1;
+        _maxDepth = 0;
+        _features = searchFeatures;
+        _solverEmpty = SOLVER_EMPTY;
+        _solverSquares = SOLVER_SQUARES;
+        _engine = ENGINE_MINIMAX;
+        _verbose = true;
+        _mcts.setVerbose(true);
+        _ponderEnabled = true;
+        _ponderAbort = false;
+        _ponderPosition.clear();
+
+        _book.open(DEFAULT_BOOK);
+    }
+
+    ~Bot() {
+        stopPonder();
+    }
+
+
+    //  while the opponent thinks, a ponder search runs in the background
+    //  and this thread keeps reading and parsing the server's commands
+    void loop() {
+        //  replies are flushed one by one, so cout needs neither stdio nor cin to flush it;
+        //  and without stdio, a log line on cerr must not flush cout from another thread
+        std::ios::sync_with_stdio(false);
+        std::cin.tie(NULL);
+        std::cerr.tie(NULL);
+
+        //  the line keeps its capacity and the tokens point into it: no allocation per command
+        std::string line;
+        Token command[MAX_TOKENS];
+        line.reserve(1024);
+
+        while (std::getline(std::cin, line)) {
+            if (!line.empty() && line[line.size() - 1] == '\r')
+                line.resize(line.size() - 1);
+
+            int count = tokenize(line.c_str(), ' ', command, MAX_TOKENS);
+
+            if (count > 0)
+                processCommand(command);
+        }
+
+        stopPonder();
+    }
+
+public:
+
+    /**
+     * Implement this function.
+     * type is always "move"
+     *
+     * return value must be position in x,y presentation
+     *      (use std::make_pair(x, y))
+     */
+    std::pair<int, int> action(const std::string &type, int time) {
+        TELEMETRY(_time_t start = _clock_t::now());
+
+        _report.source = "search";
+        _report.budget = 0;
+        _report.solver = "none";
+        _report.score = 0;
+        _report.stats.clear();
+
+        _move_t move = chooseMove(time);
+
+        TELEMETRY(reportAction(move, time, start));
+        return move;
+    }
+
+    //  the move of action(); _report tells where it came from
+    _move_t chooseMove(int time) {
+        _move_t nextMove;
+
+        //  a ponder search of another position is of no use anymore
+        if (!_position.same(_ponderPosition))
+            stopPonder();
+
+        //  book moves cost no time, so the bank is kept for the middlegame
+        int bookMove = _book.probe(_position);
+        if (bookMove >= 0) {
+            if (_verbose)
+                std::cerr << "book: " << convertToCoord(bookMove).first << " " << convertToCoord(bookMove).second
+                          << std::endl;
+            _report.source = "book";
+            return convertToCoord(bookMove);
+        }
+
+        _report.source = "rule";
+
+        //  make the first move in the center
+        if (_move == 1)
+            return _move_t(4, 4);
+
+
+        //  if I have to move in an empty square, do it so the opponent's move
+        //  will be in the same square -> better control
+        if (isEmptySquare()) {
+            int s = __builtin_ctz(_position.playable());
+            return convertToCoord(9 * s + s);
+        }
+
+
+        //  if there is a square that can be won directly
+        //  that will lead to the end of the game in my favor
+        if (multipleActiveSquares()) {
+            nextMove = tryToWinGame(_botId);
+
+            //  if such a move exists
+            if (nextMove.first != -1 && nextMove.second != -1)
+                return nextMove;
+        }
+
+
+        //  get best move using minimax, deepening until the time for this move is spent
+        int budget = getTimeBudget(time);
+        _score_t score;
+        long nodes;
+
+        _report.source = "search";
+        _report.budget = budget;
+
+        _time_t deadline = _clock_t::now() + std::chrono::milliseconds(budget);
+        int best;
+        _mask81_t searchMoves = ALL_CELLS;
+
+        //  close to the end, prove the result instead of estimating it, in half the budget at most
+        if (solverApplies()) {
+            Solver solver(&_wdl);
+            SolverResult proven = solver.solveRoot(_position, _botId,
+                                                   _clock_t::now() + std::chrono::milliseconds(budget / 2));
+
+            if (_verbose)
+                std::cerr << "solver: " << WDL_NAMES[proven.result + 1] << (proven.complete ? ("") : (" or better"))
+                          << " (" << proven.nodes << " nodes)" << std::endl;
+
+            _report.solver = proven.complete ? (WDL_NAMES[proven.result + 1]) : ("unknown");
+
+            //  a proven win, or a draw when nothing better exists, needs no more thought
+            if (proven.complete && proven.result != WDL_LOSS) {
+                stopPonder();
+                _report.source = "solver";
+                _report.stats.nodes = proven.nodes;
+                return convertToCoord(proven.move);
+            }
+
+            //  when every move loses, the heuristics choose the one the opponent may get wrong
+            _mask81_t moves = _position.getAvailableMoves();
+            if ((moves & ~proven.losing) != 0 && proven.losing != 0) {
+                searchMoves = ~proven.losing;
+                stopPonder();
+            }
+        }
+
+        if (_ponder.valid()) {
+            //  ponder hit: the search already runs on this position, give it the budget too
+            _ponder.wait_until(deadline);
+            best = stopPonder();
+            score = _ponderScore;
+            if (_verbose)
+                std::cerr << "ponder hit: " << _ponderNodes << " nodes" << std::endl;
+
+            _report.source = "ponder";
+            _report.stats = _ponderStats;
+        }
+        else if (_engine == ENGINE_MCTS) {
+            best = _mcts.think(_position, _botId, deadline, searchMoves);
+            score = 0;
+            _report.source = "mcts";
+            _report.stats.nodes = _mcts.playouts();
+        }
+        else {
+            _tt.newSearch();
+            best = parallelThink(_position, _botId, &_tt, _threads, maxDepth(_position),
+                                 deadline, score, nodes, NULL, searchMoves, &_report.stats, _features, _verbose);
+        }
+
+        _report.score = score;
+        nextMove = convertToCoord(best);
+
+        if (_verbose)
+            std::cerr << "next: " << nextMove.first << " " << nextMove.second << " " << score << std::endl;
+
+        return nextMove;
+    }
+
+
+    //  the only active square is still empty
+    bool isEmptySquare() {
+        int active = _position.playable();
+
+        return __builtin_popcount(active) == 1 && _position.occupied(__builtin_ctz(active)) == 0;
+    }
+
+    //  used at final states: wins the entire game (without alpha-beta)
+    _move_t tryToWinGame(int player) {
+        //  the squares that would win the game, if they can still be played now
+        int squares = getPos(_position.won[player - 1]) & _position.playable();
+
+        for (; squares; squares &= squares - 1) {
+            int s = __builtin_ctz(squares);
+
+            //  the cells that would win the square
+            int cells = _position.info(s).threats[player - 1];
+
+            if (cells)
+                return convertToCoord(9 * s + __builtin_ctz(cells));
+        }
+
+        return _move_t(-1, -1);
+    }
+
+
+    /* pondering */
+
+    //  searches the position after the opponent's expected answer to myMove,
+    //  as found by the last search, until the next action or until the field says otherwise
+    void startPonder(int myMove) {
+        stopPonder();
+
+        if (!_ponderEnabled || _engine != ENGINE_MINIMAX)
+            return;
+
+        Position next = _position;
+        next.simulateMove(myMove, _botId);
+
+        TTEntry entry;
+        if (next.gameIsFinished() || !_tt.probe(next.hash, entry) || entry.move < 0 ||
+            (next.getAvailableMoves() & cellMask(entry.move)) == 0)
+            return;
+
+        next.simulateMove(entry.move, _opponentId);
+
+        if (next.gameIsFinished())
+            return;
+
+        _ponderPosition = next;
+        _ponderAbort = false;
+        _tt.newSearch();
+
+        //  silent: this thread owns cout and cerr, and the server reads the replies from cout
+        _ponder = std::async(std::launch::async, [this]() {
+            return parallelThink(_ponderPosition, _botId, &_tt, _threads, maxDepth(_ponderPosition),
+                                 _time_t::max(), _ponderScore, _ponderNodes, &_ponderAbort, ALL_CELLS,
+                                 &_ponderStats, _features, false);
+        });
+    }
+
+    //  stops the ponder search, if any, and returns its best move (cell) or -1
+    int stopPonder() {
+        if (!_ponder.valid())
+            return -1;
+
+        _ponderAbort = true;
+        int best = _ponder.get();
+        _ponderPosition.clear();
+
+        return best;
+    }
+
+
+#ifdef UTTT_TELEMETRY
+    /* telemetry */
+
+    //  one JSON line per action, on stderr or appended to the file of the telemetry setting
+    void reportAction(_move_t move, int time, _time_t start) {
+        const SearchStats &stats = _report.stats;
+        long elapsed = (long) std::chrono::duration_cast<std::chrono::milliseconds>(_clock_t::now() - start).count();
+        char line[512];
+
+        snprintf(line, sizeof(line),
+                 "{\"round\":%d,\"move\":%d,\"source\":\"%s\",\"x\":%d,\"y\":%d,\"score\":%lld,"
+                 "\"timebank_ms\":%d,\"budget_ms\":%d,\"time_ms\":%ld,\"depth\":%d,\"nodes\":%ld,"
+                 "\"evals\":%ld,\"cutoffs\":%ld,\"first_cutoff_rate\":%.3f,\"ebf\":%.2f,"
+                 "\"tt_hit_rate\":%.3f,\"solver\":\"%s\"}\n",
+                 _round, _move, _report.source, move.first, move.second, (long long) _report.score,
+                 time, _report.budget, elapsed, stats.depth, stats.nodes,
+                 stats.evals, stats.cutoffs, (stats.cutoffs > 0) ? ((double) stats.firstCutoffs / stats.cutoffs) : (0),
+                 stats.branchingFactor(), (stats.ttProbes > 0) ? ((double) stats.ttHits / stats.ttProbes) : (0),
+                 _report.solver);
+
+        std::ostream &out = _telemetryFile.is_open() ? (std::ostream &) _telemetryFile : std::cerr;
+        out << line << std::flush;
+    }
+#endif
+
+
+    /* new game */
+
+    //  forgets everything learned in the previous game, for a caller that plays several in a row
+    void newGame() {
+        stopPonder();
+        _tt.clear();
+        _wdl.clear();
+        _mcts.clear();
+        _position.clear();
+        _round = 0;
+        _move = 0;
+    }
+
+
+    /* time */
+
+    //  milliseconds to spend on this move, given the time left in the timebank:
+    //  time_per_move comes back after every move, and the rest of the bank is spread
+    //  over the moves I expect to still play
+    int getTimeBudget(int time) {
+        int empty = _position.emptyCells();
+        int movesLeft = std::max(MIN_MOVES_LEFT, empty / 4);
+
+        int budget = _timePerMove / 2 + time / movesLeft;
+
+        //  never risk a large part of the bank on one move; a nearly empty bank
+        //  leaves a budget <= 0, which still plays the first iteration's move
+        return std::min(budget, time / 3) - TIME_MARGIN;
+    }
+
+
+    //  few empty cells, or few squares left to play in
+    bool solverApplies() {
+        int open = __builtin_popcount(SQUARE_FULL & ~_position.closed());
+
+        return _position.emptyCells() <= _solverEmpty || open <= _solverSquares;
+    }
+
+    //  the search is limited by time only, unless the depth setting says otherwise
+    int maxDepth(const Position &position) {
+        return (_maxDepth > 0) ? (std::min(_maxDepth, position.emptyCells())) : (position.emptyCells());
+    }
+
+
+    /* field */
+
+    bool multipleActiveSquares() {
+        return __builtin_popcount(_position.playable()) >= 2;
+    }
+
+    /* parsing */
+
+    void processCommand(const Token *command) {
+        if (command[0].is("action")) {
+            const char *time = command[2].begin;
+            _move_t point = action(command[1].str(), parseInt(time));
+
+            //  one write and one flush per reply
+            char reply[] = "place_move x y\n";
+            reply[11] = (char) ('0' + point.first);
+            reply[13] = (char) ('0' + point.second);
+            std::cout.write(reply, sizeof(reply) - 1).flush();
+
+            startPonder(convertToInt(point));
+        }
+        else if (command[0].is("update")) {
+            update(command[1], command[2], command[3]);
+        }
+        else if (command[0].is("settings")) {
+            setting(command[1].str(), command[2].str());
+        }
+        else {
+            debug("Unknown command <" + command[0].str() + ">.");
+        }
+    }
+
+    //  for callers without a command line
+    void update(const std::string &player, const std::string &type, const std::string &value) {
+        update(Token(player), Token(type), Token(value));
+    }
+
+    //  the field and macroboard go straight from the line into the position
+    void update(const Token &player, const Token &type, const Token &value) {
+        if (!player.is("game") && !player.is(_myName)) {
+            // It's not my update!
+            return;
+        }
+
+        const char *p = value.begin;
+
+        if (type.is("round")) {
+            _round = parseInt(p);
+        }
+        else if (type.is("move")) {
+            _move = parseInt(p);
+        }
+        else if (type.is("field")) {
+            _position.setField(p);
+
+            //  ponder miss: the opponent played something else
+            if (_position.cells[0] != _ponderPosition.cells[0] || _position.cells[1] != _ponderPosition.cells[1])
+                stopPonder();
+        }
+        else if (type.is("macroboard")) {
+            _position.setMacroboard(p);
+        }
+        else {
+            debug("Unknown update <" + type.str() + ">.");
+        }
+    }
+
+    void setting(const std::string &type, const std::string &value) {
+        //  the ponder search uses the table and the settings
+        stopPonder();
+
+        if (type == "timebank") {
+            _timebank = stringToInt(value);
+        }
+        else if (type == "time_per_move") {
+            _timePerMove = stringToInt(value);
+        }
+        else if (type == "player_names") {
+            split(value, ',', _playerNames);
+        }
+        else if (type == "your_bot") {
+            _myName = value;
+        }
+        else if (type == "engine") {
+            _engine = (value == "mcts") ? (ENGINE_MCTS) : (ENGINE_MINIMAX);
+        }
+        else if (type == "verbose") {
+            _verbose = stringToInt(value) != 0;
+            _mcts.setVerbose(_verbose);
+        }
+        else if (type == "ponder") {
+            _ponderEnabled = stringToInt(value) != 0;
+        }
+        else if (type == "threads") {
+            _threads = std::max(1, stringToInt(value));
+        }
+        else if (type == "depth") {
+            _maxDepth = std::max(0, stringToInt(value));
+        }
+        else if (type == "selective") {
+            int features = parseFeatures(value);
+
+            if (features >= 0)
+                _features = features;
+            else
+                debug("Unknown search feature in <" + value + ">.");
+        }
+        else if (type == "book") {
+            if (value == "none")
+                _book.close();
+            else if (!_book.open(value))
+                debug("Cannot open book <" + value + ">.");
+        }
+        else if (type == "solver_empty") {
+            _solverEmpty = stringToInt(value);
+        }
+        else if (type == "solver_squares") {
+            _solverSquares = stringToInt(value);
+        }
+        else if (type == "wdl_mb") {
+            _wdl.resize(stringToInt(value));
+        }
+#ifdef UTTT_TELEMETRY
+        else if (type == "telemetry") {
+            _telemetryFile.close();
+
+            if (value != "stderr")
+                _telemetryFile.open(value.c_str(), std::ios::app);
+        }
+#endif
+        else if (type == "hash_mb") {
+            _tt.resize(stringToInt(value));
+        }
+        else if (type == "your_botid") {
+            _botId = stringToInt(value);
+            _opponentId = (_botId == 1) ? (2) : (1);
+        }
+        else {
+            debug("Unknown setting <" + type + ">.");
+        }
+    }
+
+    void debug(const std::string &s) const {
+        std::cerr << s << std::endl << std::flush;
+    }
+
+public:
+    // static settings
+    int _timebank;
+    int _timePerMove;
+    int _threads;
+    int _maxDepth;          //  0 for no limit
+    int _features;          //  FEATURE_* of the selective search
+    int _solverEmpty;       //  the solver runs at this many empty cells or fewer,
+    int _solverSquares;     //  or at this many open squares or fewer
+    _engine_t _engine;
+    bool _verbose;          //  the moves and the search iterations on stderr
+    int _botId;
+    int _opponentId;
+
+    std::vector<std::string> _playerNames;
+    std::string _myName;
+
+    // dynamic settings
+    int _round;
+    int _move;
+    Position _position;
+
+    //  kept between moves
+    TranspositionTable _tt;
+    WDLCache _wdl;
+    MonteCarlo _mcts;
+    OpeningBook _book;
+
+    //  pondering
+    bool _ponderEnabled;
+    std::future<int> _ponder;           //  valid while a ponder search runs
+    std::atomic<bool> _ponderAbort;
+    Position _ponderPosition;
+    _score_t _ponderScore;
+    long _ponderNodes;
+    SearchStats _ponderStats;
+
+    //  what the last action did
+    struct ActionReport {
+        const char *source;     //  book, rule, solver, ponder, mcts or search
+        int budget;             //  milliseconds, 0 if no search was needed
+        const char *solver;     //  win, draw, loss, unknown, or none if it did not run
+        _score_t score;
+        SearchStats stats;
+    } _report;
+
+#ifdef UTTT_TELEMETRY
+    std::ofstream _telemetryFile;
+#endif
+};
+
+#endif
@@ -0,0 +1,943 @@
+/*******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 Abdulla Gaibullaev
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ ******************************************************************************/
+
+#include "uttt_engine.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define UTTT_X86
+#endif
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+
+std::vector<std::string> &split(const std::string &s, char delim, std::vector<std::string> &elems) {
+    std::stringstream ss(s);
+    std::string item;
+    elems.clear();
+    while (std::getline(ss, item, delim)) {
+        elems.push_back(item);
+    }
+    return elems;
+}
+
+
+int stringToInt(const std::string &s) {
+    const char *p = s.c_str();
+    return parseInt(p);
+}
+
+
+int tokenize(const char *line, char delim, Token *tokens, int max) {
+    int count = 0;
+
+    for (int i = 0; i < max; i++)
+        tokens[i] = Token();
+
+    while (*line && count < max) {
+        const char *end = line;
+
+        while (*end && *end != delim)
+            end++;
+
+        tokens[count].begin = line;
+        tokens[count].length = (int) (end - line);
+        count++;
+
+        line = *end ? end + 1 : end;
+    }
+
+    return count;
+}
+
+
+/* 9-bit patterns */
+
+bool winnerTable[SQUARE_FULL + 1];
+int posTable[SQUARE_FULL + 1];
+int ternary[SQUARE_FULL + 1];
+SquareInfo squareTable[SQUARE_STATES];
+
+_score_t squareScore(int mine, int theirs, const EvalWeights &weights) {
+    _score_t score = 0;
+
+    for (int wp : winningPatterns) {
+        _score_t line = 1;
+
+        for (int k = 0; k < 9; k++) {
+            if ((wp >> k) & 1)
+                line *= ((mine >> k) & 1) ? (weights.cellMine) :
+                        (((theirs >> k) & 1) ? (weights.cellTheirs) : (weights.cellEmpty));
+        }
+
+        score += line;
+    }
+
+    return score;
+}
+
+void initTables() {
+    for (int p = 0; p <= SQUARE_FULL; p++) {
+        winnerTable[p] = false;
+        posTable[p] = 0;
+        ternary[p] = 0;
+
+        for (int wp : winningPatterns) {
+            if ((p & wp) == wp)
+                winnerTable[p] = true;
+
+            if (__builtin_popcount(p & wp) == 2)
+                posTable[p] |= wp & ~p;
+        }
+
+        for (int k = 8; k >= 0; k--)
+            ternary[p] = 3 * ternary[p] + ((p >> k) & 1);
+    }
+
+    for (int first = 0; first <= SQUARE_FULL; first++) {
+        for (int second = 0; second <= SQUARE_FULL; second++) {
+            if (first & second)
+                continue;
+
+            SquareInfo &info = squareTable[ternary[first] + 2 * ternary[second]];
+            int empty = SQUARE_FULL & ~(first | second);
+
+            info.score[0] = (short) squareScore(first, second, ENGINE_WEIGHTS);
+            info.score[1] = (short) squareScore(second, first, ENGINE_WEIGHTS);
+            info.threats[0] = (short) (getPos(first) & empty);
+            info.threats[1] = (short) (getPos(second) & empty);
+            info.winner = (char) (isWinner(first) ? (1) : (isWinner(second) ? (2) : (0)));
+            info.full = (char) squareIsDraw(first | second);
+        }
+    }
+}
+
+
+/* zobrist keys */
+
+__uint64_t zobristCells[2][81];
+__uint64_t zobristActive[SQUARE_FULL + 1];
+__uint64_t zobristSide;
+
+void initZobrist() {
+    Random random;
+
+    for (int p = 0; p < 2; p++) {
+        for (int cell = 0; cell < 81; cell++)
+            zobristCells[p][cell] = random.next();
+    }
+
+    for (int active = 0; active <= SQUARE_FULL; active++)
+        zobristActive[active] = random.next();
+
+    zobristSide = random.next();
+}
+
+void initEngine() {
+    //  a static's initializer runs once, and other threads calling meanwhile wait for it
+    static bool initialized = []() {
+        initZobrist();
+        initTables();
+
+        //  the first one the cpu runs
+        selectEvaluator("avx2") || selectEvaluator("sse4") || selectEvaluator("scalar");
+
+        return true;
+    }();
+
+    (void) initialized;
+}
+
+
+/* evaluation weights */
+
+bool weightsFit(const EvalWeights &weights) {
+    if (weights.cellEmpty < 0 || weights.cellMine < 0 || weights.cellTheirs < 0 || weights.microWin < 1 ||
+        (_score_t) weights.microWin * weights.microWin * weights.microWin > INT32_MAX)
+        return false;
+
+    //  the squares nobody won
+    for (int first = 0; first <= SQUARE_FULL; first++) {
+        for (int second = 0; second <= SQUARE_FULL; second++) {
+            if ((first & second) == 0 && !isWinner(first) && !isWinner(second) &&
+                squareScore(first, second, weights) > weights.microWin)
+                return false;
+        }
+    }
+
+    return true;
+}
+
+void SquareValueTable::fill(const EvalWeights &weights) {
+    for (int first = 0; first <= SQUARE_FULL; first++) {
+        for (int second = 0; second <= SQUARE_FULL; second++) {
+            if (first & second)
+                continue;
+
+            __int32_t *value = values[ternary[first] + 2 * ternary[second]];
+
+            if (isWinner(first) || isWinner(second)) {
+                value[0] = isWinner(first) ? (weights.microWin) : (0);
+                value[1] = isWinner(second) ? (weights.microWin) : (0);
+            }
+            else {
+                value[0] = (__int32_t) squareScore(first, second, weights);
+                value[1] = (__int32_t) squareScore(second, first, weights);
+            }
+        }
+    }
+}
+
+
+/* leaf evaluation */
+
+_score_t evaluateLinesScalar(const __int32_t squares[2][9]) {
+    return lineProducts(squares[0]) - lineProducts(squares[1]);
+}
+
+#ifdef UTTT_X86
+
+//  both versions compute the 8 line products of each player in 32-bit lanes, subtract
+//  them lane by lane (still within 32 bits) and add the lanes up in 64 bits
+
+//  the lanes are shuffled out of squares 0-3 and 4-7, square 8 is inserted
+__attribute__((target("sse4.1")))
+_score_t evaluateLinesSSE4(const __int32_t squares[2][9]) {
+    __m128i diff[2];
+
+    for (int p = 0; p < 2; p++) {
+        __m128i low = _mm_loadu_si128((const __m128i *) squares[p]);
+        __m128i high = _mm_loadu_si128((const __m128i *) (squares[p] + 4));
+        int last = squares[p][8];
+
+        //  rows and the first column: (0 3 6 0) (1 4 7 3) (2 5 8 6)
+        __m128i a = _mm_blend_epi16(_mm_shuffle_epi32(low, _MM_SHUFFLE(0, 0, 3, 0)),
+                                    _mm_shuffle_epi32(high, _MM_SHUFFLE(0, 2, 0, 0)), 0x30);
+        __m128i b = _mm_blend_epi16(_mm_shuffle_epi32(low, _MM_SHUFFLE(3, 0, 0, 1)),
+                                    _mm_shuffle_epi32(high, _MM_SHUFFLE(0, 3, 0, 0)), 0x3c);
+        __m128i c = _mm_insert_epi32(_mm_blend_epi16(_mm_shuffle_epi32(low, _MM_SHUFFLE(0, 0, 0, 2)),
+                                                     _mm_shuffle_epi32(high, _MM_SHUFFLE(2, 0, 1, 0)), 0xcc), last, 2);
+        __m128i first = _mm_mullo_epi32(_mm_mullo_epi32(a, b), c);
+
+        //  the other columns and the diagonals: (1 2 0 6) (4 5 4 4) (7 8 8 2)
+        a = _mm_blend_epi16(_mm_shuffle_epi32(low, _MM_SHUFFLE(0, 0, 2, 1)),
+                            _mm_shuffle_epi32(high, _MM_SHUFFLE(2, 0, 0, 0)), 0xc0);
+        b = _mm_shuffle_epi32(high, _MM_SHUFFLE(0, 0, 1, 0));
+        c = _mm_insert_epi32(_mm_insert_epi32(_mm_blend_epi16(_mm_shuffle_epi32(high, _MM_SHUFFLE(0, 0, 0, 3)),
+                                                              _mm_shuffle_epi32(low, _MM_SHUFFLE(2, 0, 0, 0)), 0xc0),
+                                              last, 1), last, 2);
+        __m128i second = _mm_mullo_epi32(_mm_mullo_epi32(a, b), c);
+
+        diff[0] = (p == 0) ? (first) : (_mm_sub_epi32(diff[0], first));
+        diff[1] = (p == 0) ? (second) : (_mm_sub_epi32(diff[1], second));
+    }
+
+    __m128i sum = _mm_add_epi64(_mm_add_epi64(_mm_cvtepi32_epi64(diff[0]), _mm_cvtepi32_epi64(_mm_srli_si128(diff[0], 8))),
+                                _mm_add_epi64(_mm_cvtepi32_epi64(diff[1]), _mm_cvtepi32_epi64(_mm_srli_si128(diff[1], 8))));
+
+    return _mm_cvtsi128_si64(sum) + _mm_extract_epi64(sum, 1);
+}
+
+__attribute__((target("avx2")))
+_score_t evaluateLinesAVX2(const __int32_t squares[2][9]) {
+    //  squares 0 to 7 are permuted into the lanes, square 8 is blended in
+    //  where a line ends with it (lanes 2, 5 and 6)
+    const __m256i first = _mm256_setr_epi32(0, 3, 6, 0, 1, 2, 0, 6);
+    const __m256i second = _mm256_setr_epi32(1, 4, 7, 3, 4, 5, 4, 4);
+    const __m256i third = _mm256_setr_epi32(2, 5, 0, 6, 7, 0, 0, 2);
+    const int LANES_OF_8 = (1 << 2) | (1 << 5) | (1 << 6);
+
+    __m256i products[2];
+
+    for (int p = 0; p < 2; p++) {
+        __m256i values = _mm256_loadu_si256((const __m256i *) squares[p]);
+        __m256i last = _mm256_set1_epi32(squares[p][8]);
+
+        __m256i a = _mm256_permutevar8x32_epi32(values, first);
+        __m256i b = _mm256_permutevar8x32_epi32(values, second);
+        __m256i c = _mm256_blend_epi32(_mm256_permutevar8x32_epi32(values, third), last, LANES_OF_8);
+
+        products[p] = _mm256_mullo_epi32(_mm256_mullo_epi32(a, b), c);
+    }
+
+    __m256i diff = _mm256_sub_epi32(products[0], products[1]);
+    __m256i sum = _mm256_add_epi64(_mm256_cvtepi32_epi64(_mm256_castsi256_si128(diff)),
+                                   _mm256_cvtepi32_epi64(_mm256_extracti128_si256(diff, 1)));
+    __m128i half = _mm_add_epi64(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+
+    return _mm_cvtsi128_si64(half) + _mm_cvtsi128_si64(_mm_unpackhi_epi64(half, half));
+}
+
+#endif
+
+_eval_lines_t evaluateLines = evaluateLinesScalar;
+const char *evaluator = "scalar";
+
+bool selectEvaluator(const std::string &name) {
+    _eval_lines_t chosen = NULL;
+
+    if (name == "scalar")
+        chosen = evaluateLinesScalar;
+#ifdef UTTT_X86
+    else if (name == "sse4" && __builtin_cpu_supports("sse4.1"))
+        chosen = evaluateLinesSSE4;
+    else if (name == "avx2" && __builtin_cpu_supports("avx2"))
+        chosen = evaluateLinesAVX2;
+#endif
+
+    if (chosen == NULL)
+        return false;
+
+    evaluateLines = chosen;
+    evaluator = (name == "scalar") ? ("scalar") : ((name == "sse4") ? ("sse4") : ("avx2"));
+    return true;
+}
+
+const char *evaluatorName() {
+    return evaluator;
+}
+
+
+/* selective search */
+
+int searchFeatures = FEATURE_DEFAULT;
+
+const char *FEATURE_NAMES[] = {"lmr", "futility", "razoring", "extensions"};
+
+int parseFeatures(const std::string &names) {
+    if (names == "all")
+        return FEATURE_ALL;
+
+    if (names == "default")
+        return FEATURE_DEFAULT;
+
+    if (names == "none")
+        return 0;
+
+    int features = 0;
+    std::vector<std::string> list;
+    std::string separated = names;
+
+    //  '+' for uttt_match, whose settings are already separated by ','
+    std::replace(separated.begin(), separated.end(), '+', ',');
+
+    for (const std::string &name : split(separated, ',', list)) {
+        int feature = 0;
+
+        for (int i = 0; i < 4; i++) {
+            if (name == FEATURE_NAMES[i])
+                feature = 1 << i;
+        }
+
+        if (feature == 0)
+            return -1;
+
+        features |= feature;
+    }
+
+    return features;
+}
+
+std::string featureNames(int features) {
+    std::string names;
+
+    for (int i = 0; i < 4; i++) {
+        if ((features >> i) & 1)
+            names += (names.empty() ? "" : ",") + std::string(FEATURE_NAMES[i]);
+    }
+
+    return names.empty() ? "none" : names;
+}
+
+
+//  helpers start at depth 1 or 2 and with the root moves rotated, so they spread out
+int searchThreads(int requested) {
+    int cores = (int) std::thread::hardware_concurrency();
+
+    return std::max(1, std::min(requested, cores));
+}
+
+int parallelThink(const Position &position, int botId, TranspositionTable *tt, int threads,
+                  int maxDepth, _time_t deadline, _score_t &score, long &nodes,
+                  const std::atomic<bool> *stop, _mask81_t searchMoves, SearchStats *stats, int features,
+                  bool verbose) {
+    std::atomic<bool> abort(false);
+    std::vector<std::unique_ptr<Search>> helpers;
+    std::vector<std::thread> workers;
+
+    threads = searchThreads(threads);
+
+    for (int id = 1; id < threads; id++) {
+        Search *helper = new Search(position, botId, tt);
+        helper->restrictRoot(searchMoves);
+        helper->setFeatures(features);
+
+        helpers.push_back(std::unique_ptr<Search>(helper));
+        workers.push_back(std::thread([helper, maxDepth, id, &abort]() {
+            helper->help(maxDepth, id, &abort);
+        }));
+    }
+
+    Search search(position, botId, tt);
+    search.restrictRoot(searchMoves);
+    search.setFeatures(features);
+    search.setVerbose(verbose);
+    int best = search.think(maxDepth, deadline, score, stop);
+
+    abort = true;
+    nodes = search.nodes();
+
+    if (stats != NULL)
+        *stats = search.stats();
+
+    for (int i = 0; i < (int) workers.size(); i++) {
+        workers[i].join();
+        nodes += helpers[i]->nodes();
+
+        if (stats != NULL)
+            stats->addCounters(helpers[i]->stats());
+    }
+
+    if (stats != NULL)
+        stats->nodes = nodes;
+
+    return best;
+}
+
+
+/* opening book */
+
+bool OpeningBook::open(const std::string &path) {
+    close();
+
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    void *map = MAP_FAILED;
+
+    if (fstat(fd, &st) == 0 && (size_t) st.st_size >= sizeof(BookHeader))
+        map = mmap(NULL, (size_t) st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+
+    //  the mapping stays valid without the descriptor
+    ::close(fd);
+
+    if (map == MAP_FAILED)
+        return false;
+
+    const BookHeader *header = (const BookHeader *) map;
+    size_t size = (size_t) st.st_size;
+
+    if (memcmp(header->magic, "UTTTBOOK", 8) != 0 || header->version != BOOK_VERSION ||
+        header->keyCheck != zobristSide || sizeof(BookHeader) + header->count * sizeof(BookEntry) > size) {
+        munmap(map, size);
+        return false;
+    }
+
+    _map = map;
+    _size = size;
+    _entries = (const BookEntry *) (header + 1);
+    _count = header->count;
+
+    return true;
+}
+
+void OpeningBook::close() {
+    if (_map != NULL)
+        munmap(_map, _size);
+
+    _map = NULL;
+    _size = 0;
+    _entries = NULL;
+    _count = 0;
+}
+
+int OpeningBook::probe(const Position &position) const {
+    const BookEntry *end = _entries + _count;
+    const BookEntry *entry = std::lower_bound(_entries, end, position.hash,
+                                              [](const BookEntry &e, __uint64_t key) { return e.key < key; });
+
+    //  a key collision must not make an illegal move
+    if (entry == end || entry->key != position.hash || entry->move >= 81 ||
+        (position.getAvailableMoves() & cellMask(entry->move)) == 0)
+        return -1;
+
+    return entry->move;
+}
+
+bool OpeningBook::write(const std::string &path, std::vector<BookEntry> entries) {
+    std::sort(entries.begin(), entries.end(), [](const BookEntry &a, const BookEntry &b) { return a.key < b.key; });
+
+    BookHeader header;
+    memcpy(header.magic, "UTTTBOOK", 8);
+    header.version = BOOK_VERSION;
+    header.count = (__uint32_t) entries.size();
+    header.keyCheck = zobristSide;
+
+    FILE *file = fopen(path.c_str(), "wb");
+    if (file == NULL)
+        return false;
+
+    bool written = fwrite(&header, sizeof(header), 1, file) == 1 &&
+                   fwrite(entries.data(), sizeof(BookEntry), entries.size(), file) == entries.size();
+
+    return fclose(file) == 0 && written;
+}
+
+
+/* benchmark */
+
+//  positions from self-play games
+const BenchPosition benchPositions[] = {
+        //  openings
+        {"0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,2,0,0,0,0,1,0,0,0,0,0,0",
+         "0,0,0,-1,0,0,0,0,0", 1},
+        {"0,0,0,0,0,0,0,0,0,0,0,0,2,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,1,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0",
+         "0,0,0,-1,0,0,0,0,0", 1},
+        {"0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,2,0,0,0,0,0,0,0,0,0,1,0,0,0,0,0",
+         "0,0,0,0,0,-1,0,0,0", 1},
+        {"0,0,1,0,0,0,0,0,0,0,0,0,0,0,0,2,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,1,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0",
+         "0,0,0,-1,0,0,0,0,0", 2},
+        {"0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,1,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,2,0,0,0,0,2,0,0,1,0,0,0,0",
+         "0,0,0,0,0,-1,0,0,0", 1},
+        {"0,0,0,0,0,0,0,0,2,0,0,0,0,0,0,0,0,0,1,0,0,0,0,0,0,1,0,0,0,0,0,0,0,0,0,1,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,2,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0",
+         "0,0,0,0,0,0,0,-1,0", 2},
+        {"0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,1,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,1,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,2,0,0,0,0,2,0,0,1,0,0,0,0",
+         "0,0,0,0,0,-1,0,0,0", 2},
+        {"0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,1,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,1,0,0,0,0,0,2,0,1,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,2,0,0,0,0,2,0,0,1,0,0,0,0",
+         "0,0,0,-1,0,0,0,0,0", 2},
+        //  free moves: the opponent was sent to a closed square
+        {"2,0,0,0,0,0,0,0,1,1,0,1,2,0,2,0,1,0,0,0,0,0,0,0,2,2,0,0,1,2,0,0,2,0,0,1,0,1,0,2,1,2,2,0,1,0,2,1,0,2,1,2,0,1,0,0,0,1,1,0,2,0,0,0,2,0,0,1,2,1,2,0,1,0,1,0,1,0,0,0,2",
+         "-1,-1,-1,-1,-1,1,-1,1,2", 2},
+        {"1,1,1,2,2,2,1,0,2,0,0,0,1,0,1,0,1,0,2,0,0,0,0,0,2,1,1,2,2,0,0,0,0,0,1,2,2,0,0,1,1,0,0,0,0,1,1,0,2,2,0,2,0,0,2,1,1,0,0,2,0,0,0,1,2,2,0,0,1,2,2,0,1,0,0,1,0,2,0,0,1",
+         "1,2,1,-1,-1,-1,-1,-1,-1", 2},
+        {"1,2,0,0,2,1,0,1,2,1,0,0,0,2,1,0,1,0,1,1,2,0,0,1,0,0,1,0,0,0,2,2,2,2,0,0,1,0,2,0,1,0,2,0,1,2,2,1,0,0,1,1,0,1,1,0,0,0,1,0,2,0,2,2,0,0,0,2,2,1,1,2,0,2,0,0,1,0,0,0,2",
+         "1,1,-1,-1,2,-1,-1,-1,2", 2},
+        {"1,1,1,1,1,2,0,0,0,2,0,2,2,2,1,2,0,0,2,2,0,0,2,0,1,1,1,1,1,0,2,1,0,2,2,0,1,1,2,0,2,1,2,1,1,0,1,0,0,0,0,2,0,0,0,0,2,1,2,0,1,2,2,0,0,1,2,0,0,0,0,0,1,0,2,0,1,2,0,0,1",
+         "1,-1,1,1,-1,2,-1,-1,-1", 2},
+        {"2,1,0,2,1,0,0,0,1,1,1,1,2,1,2,0,1,0,1,0,0,2,0,0,2,2,0,2,1,2,2,2,2,0,0,1,0,1,0,2,1,2,2,0,1,0,2,1,0,2,1,2,0,1,2,0,0,1,1,0,2,0,0,0,2,0,0,1,2,1,2,0,1,1,1,0,1,0,0,0,2",
+         "1,2,-1,-1,2,1,1,1,2", 2},
+        {"2,1,0,2,1,0,0,0,1,1,1,1,2,1,2,0,1,0,1,0,0,2,0,0,2,2,0,2,1,2,2,2,2,0,0,1,2,1,0,2,1,2,2,0,1,1,2,1,0,2,1,2,0,1,2,0,0,1,1,0,2,0,0,0,2,0,0,1,2,1,2,0,1,1,1,0,1,0,0,0,2",
+         "1,2,-1,-1,2,1,1,1,2", 2},
+        {"1,1,1,1,1,2,0,0,0,2,0,2,2,2,1,2,0,0,2,2,0,0,2,1,1,1,1,1,1,0,2,1,0,2,2,0,1,1,2,0,2,1,2,1,1,0,1,0,0,0,0,2,0,0,2,2,2,1,2,0,1,2,2,0,0,1,2,0,0,0,0,0,1,0,2,1,1,2,0,2,1",
+         "1,-1,1,1,-1,2,2,-1,-1", 1},
+        {"1,1,1,1,1,2,0,0,0,2,0,2,2,2,1,2,0,0,2,2,0,0,2,1,1,1,1,1,1,0,2,1,0,2,2,0,1,1,2,0,2,1,2,1,1,0,1,0,0,0,2,2,0,0,2,2,2,1,2,0,1,2,2,0,0,1,2,0,0,0,1,0,1,0,2,1,1,2,0,2,1",
+         "1,-1,1,1,2,2,2,-1,1", 1},
+        //  middlegames
+        {"0,0,0,0,2,0,0,0,2,0,0,0,0,0,0,0,0,0,1,0,0,0,0,1,0,1,0,0,1,0,0,0,0,0,0,1,2,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,2,1,0,0,1,0,0,0,0,0,0,2,0,0,0,2",
+         "0,0,0,-1,0,0,0,0,0", 2},
+        {"0,0,0,0,2,0,0,0,0,0,0,0,0,0,1,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,1,0,2,0,0,0,0,0,0,0,0,1,1,0,0,0,0,2,0,0,2,0,0,0,0,0,0,0,0,1,0,2,0,0,0,2,0,0,0,0,0,1,0,2,0,0,1",
+         "-1,0,0,0,0,0,0,0,0", 1},
+        {"1,0,2,0,1,0,0,0,1,0,0,0,0,0,0,0,0,0,0,0,0,0,2,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,1,0,0,1,0,0,0,0,2,0,2,0,0,0,2,0,0,0,0,0,0,0,0,0,0,2,0,2,0,0,1,1,1,0,0,0,0",
+         "0,0,-1,0,0,0,0,0,0", 2},
+        {"0,0,0,0,2,0,0,0,2,0,1,0,0,0,0,0,0,0,1,0,0,0,0,1,0,1,0,2,1,0,1,0,0,0,0,1,2,0,0,0,2,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,2,1,0,0,1,0,0,0,0,0,0,2,0,0,0,2",
+         "-1,0,0,0,0,0,0,0,0", 2},
+        {"1,0,0,0,2,0,0,0,0,0,0,0,0,0,1,0,0,0,2,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,1,0,2,0,0,0,0,0,0,0,0,1,1,0,0,0,0,2,0,0,2,0,1,0,0,0,0,0,0,1,0,2,0,0,0,2,0,0,0,0,0,1,0,2,0,0,1",
+         "0,0,-1,0,0,0,0,0,0", 2},
+        {"0,2,0,0,2,1,0,1,2,0,0,0,0,2,1,0,0,0,1,1,0,0,0,0,0,0,1,0,0,0,0,0,2,2,0,0,1,0,0,0,1,0,2,0,1,2,2,0,0,0,1,0,0,0,1,0,0,0,1,0,0,0,0,0,0,0,0,2,2,1,0,0,0,2,0,0,1,0,0,0,2",
+         "0,0,0,0,0,0,0,0,-1", 2},
+        {"1,2,0,0,2,1,0,1,2,0,0,0,0,2,1,0,0,0,1,1,0,0,0,0,0,0,1,0,0,0,0,0,2,2,0,0,1,0,0,0,1,0,2,0,1,2,2,0,0,0,1,0,0,0,1,0,0,0,1,0,2,0,0,0,0,0,0,2,2,1,0,0,0,2,0,0,1,0,0,0,2",
+         "-1,0,0,0,0,0,0,0,0", 2},
+        {"2,0,0,0,0,0,0,0,1,1,0,1,2,0,2,0,1,0,0,0,0,0,0,0,2,2,0,0,1,2,0,0,2,0,0,1,0,1,0,2,1,2,2,0,1,0,2,1,0,2,0,2,0,1,0,0,0,1,1,0,2,0,0,0,2,0,0,1,2,1,0,0,1,0,1,0,1,0,0,0,2",
+         "0,0,0,0,0,1,0,1,-1", 2},
+        {"1,2,0,0,2,1,0,1,2,1,0,0,0,2,1,0,0,0,1,1,2,0,0,0,0,0,1,0,0,0,2,0,2,2,0,0,1,0,2,0,1,0,2,0,1,2,2,0,0,0,1,1,0,0,1,0,0,0,1,0,2,0,0,0,0,0,0,2,2,1,1,0,0,2,0,0,1,0,0,0,2",
+         "1,0,0,0,0,0,-1,0,0", 2},
+        {"2,0,0,0,0,0,0,0,1,1,0,1,2,0,2,0,1,0,0,0,0,0,0,0,2,2,0,0,1,2,0,0,2,0,0,1,0,1,0,2,1,2,2,0,1,0,2,1,0,2,0,2,0,1,0,0,0,1,1,0,2,0,0,0,2,0,0,1,2,1,2,0,1,0,1,0,1,0,0,0,2",
+         "0,0,0,0,-1,1,0,1,2", 1},
+        //  late middlegames and endgames
+        {"1,2,0,0,2,1,0,1,2,1,0,0,0,2,1,0,1,0,1,1,2,0,0,0,0,0,1,0,0,0,2,2,2,2,0,0,1,0,2,0,1,0,2,0,1,2,2,1,0,0,1,1,0,1,1,0,0,0,1,0,2,0,2,2,0,0,0,2,2,1,1,2,0,2,0,0,1,0,0,0,2",
+         "1,-1,0,0,2,0,0,0,2", 1},
+        {"1,2,0,0,2,1,0,1,2,1,0,0,0,2,1,0,1,0,1,1,2,0,0,1,0,0,1,0,0,0,2,2,2,2,0,0,1,0,2,0,1,0,2,0,1,2,2,1,0,0,1,1,0,1,1,0,0,0,1,0,2,0,2,2,0,2,0,2,2,1,1,2,0,2,0,0,1,0,0,0,2",
+         "1,1,0,0,2,-1,0,0,2", 1},
+        {"1,0,2,2,1,0,0,0,1,1,2,0,2,2,0,0,0,0,0,0,0,0,2,2,2,2,2,0,1,0,0,1,0,0,1,0,1,0,2,2,2,1,0,2,1,0,2,1,1,0,1,0,2,0,2,0,1,0,2,1,1,1,0,0,2,0,0,1,0,2,1,2,0,0,1,1,1,0,0,0,2",
+         "0,2,2,0,-1,0,0,1,0", 1},
+        {"0,1,1,1,1,2,0,0,0,2,0,2,2,2,1,2,0,0,2,2,0,0,2,0,1,1,1,1,1,0,2,1,0,2,2,0,1,1,2,0,2,1,2,1,1,0,1,0,0,0,0,2,0,0,0,0,2,1,2,0,1,2,2,0,0,1,2,0,0,0,0,0,1,0,2,0,1,2,0,0,1",
+         "-1,0,1,1,0,2,0,0,0", 1},
+        {"2,1,0,2,0,0,0,0,1,1,1,1,2,1,2,0,1,0,1,0,0,0,0,0,2,2,0,2,1,2,2,2,2,0,0,1,0,1,0,2,1,2,2,0,1,0,2,1,0,2,1,2,0,1,2,0,0,1,1,0,2,0,0,0,2,0,0,1,2,1,2,0,1,0,1,0,1,0,0,0,2",
+         "1,-1,0,0,2,1,0,1,2", 1},
+        {"1,1,1,2,2,2,1,0,2,0,0,0,1,0,1,0,1,0,2,0,0,0,0,0,2,1,1,2,2,0,0,0,0,0,1,2,2,0,0,1,1,0,0,0,2,1,1,0,2,2,2,2,1,0,2,1,1,0,0,2,0,0,0,1,2,2,1,0,1,2,2,1,1,0,0,1,2,2,0,0,1",
+         "1,2,1,-1,2,0,0,0,0", 2},
+        {"1,1,1,1,1,2,0,0,0,2,0,2,2,2,1,2,0,0,2,2,0,0,2,0,1,1,1,1,1,0,2,1,0,2,2,0,1,1,2,0,2,1,2,1,1,0,1,0,0,0,0,2,0,0,0,2,2,1,2,0,1,2,2,0,0,1,2,0,0,0,0,0,1,0,2,0,1,2,0,0,1",
+         "1,-1,1,1,0,2,0,0,0", 1},
+        {"1,1,1,2,2,2,1,0,2,0,0,0,1,0,1,0,1,0,2,0,0,0,0,0,2,1,1,2,2,0,0,0,0,0,1,2,2,0,0,1,1,0,0,0,2,1,1,2,2,2,2,2,1,0,2,1,1,0,0,2,0,0,0,1,2,2,1,0,1,2,2,1,1,0,0,1,2,2,0,0,1",
+         "1,2,1,0,2,0,0,0,-1", 1},
+        {"1,1,1,1,1,2,0,0,0,2,0,2,2,2,1,2,0,0,2,2,0,0,2,1,1,1,1,1,1,0,2,1,0,2,2,0,1,1,2,0,2,1,2,1,1,0,1,0,0,0,0,2,0,0,0,2,2,1,2,0,1,2,2,0,0,1,2,0,0,0,0,0,1,0,2,1,1,2,0,2,1",
+         "1,0,1,1,0,2,-1,0,0", 2},
+        {"1,1,1,2,2,2,1,0,2,0,0,0,1,0,1,0,1,0,2,0,0,0,0,0,2,1,1,2,2,0,0,0,0,0,1,2,2,0,0,1,1,0,0,0,2,1,1,2,2,2,2,2,1,0,2,1,1,0,0,2,0,0,0,1,2,2,1,2,1,2,2,1,1,1,0,1,2,2,0,1,1",
+         "1,2,1,0,2,0,0,-1,0", 2},
+};
+
+const int BENCH_POSITIONS = sizeof(benchPositions) / sizeof(benchPositions[0]);
+
+Position benchPosition(const BenchPosition &bench) {
+    Position position;
+
+    position.clear();
+    position.setField(bench.field);
+    position.setMacroboard(bench.macroboard);
+
+    return position;
+}
+
+void bench(int depth) {
+    TranspositionTable tt;
+    long totalNodes = 0;
+    _time_t start = _clock_t::now();
+
+    for (int i = 0; i < BENCH_POSITIONS; i++) {
+        const BenchPosition &bench = benchPositions[i];
+        Position position = benchPosition(bench);
+        _score_t score;
+        long nodes;
+
+        tt.clear();
+        tt.newSearch();
+        int best = parallelThink(position, bench.player, &tt, 1, std::min(depth, position.emptyCells()),
+                                 _time_t::max(), score, nodes);
+        totalNodes += nodes;
+
+        std::cout << "position " << i + 1 << "/" << BENCH_POSITIONS << ": " << convertToCoord(best).first << " "
+                  << convertToCoord(best).second << " score " << score << ", " << nodes << " nodes" << std::endl;
+    }
+
+    double seconds = std::chrono::duration<double>(_clock_t::now() - start).count();
+
+    std::cout << "===========================" << std::endl
+              << "Total time (ms) : " << (long) (seconds * 1000) << std::endl
+              << "Nodes searched  : " << totalNodes << std::endl
+              << "Nodes/second    : " << (long) (totalNodes / seconds) << std::endl
+              << "Features        : " << featureNames(searchFeatures) << std::endl
+              << "Signature       : " << totalNodes << std::endl;
+}
+
+void smpBench(int depth) {
+    TranspositionTable tt;
+    double serial = 0;
+
+    std::cout << std::thread::hardware_concurrency() << " hardware threads" << std::endl;
+
+    //  more threads than cores would run as many as the cores
+    for (int threads = 1; threads <= 8 && threads <= searchThreads(threads); threads *= 2) {
+        long totalNodes = 0;
+        _time_t start = _clock_t::now();
+
+        for (const BenchPosition &bench : benchPositions) {
+            _score_t score;
+            long nodes;
+            Position position = benchPosition(bench);
+
+            tt.clear();
+            tt.newSearch();
+            parallelThink(position, bench.player, &tt, threads, std::min(depth, position.emptyCells()),
+                          _time_t::max(), score, nodes);
+            totalNodes += nodes;
+        }
+
+        double seconds = std::chrono::duration<double>(_clock_t::now() - start).count();
+        if (threads == 1)
+            serial = seconds;
+
+        std::cout << "threads " << threads << ": " << (long) (seconds * 1000) << " ms, " << totalNodes
+                  << " nodes, speedup " << serial / seconds << std::endl;
+    }
+}
+
+
+/* perft */
+
+//  one position per slot, same lockless scheme as the transposition table
+struct PerftSlot {
+    std::atomic<__uint64_t> check;  //  key xor count
+    std::atomic<__uint64_t> count;
+};
+
+const int PERFT_HASH_MB = 64;
+
+/**
+ * Leaf counts of positions already walked, so transpositions are counted once.
+ * The depth is part of the key; the newest entry always wins its slot.
+ */
+class PerftTable {
+
+public:
+
+    explicit PerftTable(int mb) {
+        size_t count = 1;
+
+        while (2 * count * sizeof(PerftSlot) <= (size_t) mb << 20)
+            count *= 2;
+
+        _slots.reset(new PerftSlot[count]());
+        _mask = count - 1;
+    }
+
+    bool probe(__uint64_t hash, int depth, __uint64_t &count) const {
+        __uint64_t key = tableKey(hash, depth);
+        const PerftSlot &slot = _slots[key & _mask];
+        __uint64_t check = slot.check.load(std::memory_order_relaxed);
+        __uint64_t stored = slot.count.load(std::memory_order_relaxed);
+
+        if ((check ^ stored) != key || stored == 0)
+            return false;
+
+        count = stored;
+        return true;
+    }
+
+    void store(__uint64_t hash, int depth, __uint64_t count) {
+        __uint64_t key = tableKey(hash, depth);
+        PerftSlot &slot = _slots[key & _mask];
+
+        slot.check.store(key ^ count, std::memory_order_relaxed);
+        slot.count.store(count, std::memory_order_relaxed);
+    }
+
+private:
+
+    static __uint64_t tableKey(__uint64_t hash, int depth) {
+        return hash ^ (__uint64_t) depth * 0x9E3779B97F4A7C15ULL;
+    }
+
+    std::unique_ptr<PerftSlot[]> _slots;
+    size_t _mask;
+};
+
+//  number of move sequences of exactly depth plies; games that end earlier count nothing
+__uint64_t perft(Position &position, int player, int depth, PerftTable *table) {
+    _mask81_t moves = position.getAvailableMoves();
+
+    if (depth <= 1)
+        return (depth == 1) ? (countCells(moves)) : (1);
+
+    __uint64_t count = 0;
+
+    if (table != NULL && table->probe(position.hash, depth, count))
+        return count;
+
+    while (moves) {
+        UndoRecord undo;
+
+        position.makeMove(popCell(moves), player, undo);
+        count += perft(position, 3 - player, depth - 1, table);
+        position.undoMove(undo);
+    }
+
+    if (table != NULL)
+        table->store(position.hash, depth, count);
+
+    return count;
+}
+
+std::vector<std::pair<int, __uint64_t> > perftDivide(const Position &position, int depth, bool hashed) {
+    std::vector<std::pair<int, __uint64_t> > divide;
+    int player = position.sideToMove();
+
+    for (_mask81_t moves = position.getAvailableMoves(); moves;)
+        divide.push_back(std::make_pair(popCell(moves), (__uint64_t) 0));
+
+    std::unique_ptr<PerftTable> table(hashed ? new PerftTable(PERFT_HASH_MB) : NULL);
+    std::atomic<size_t> nextMove(0);
+
+    auto worker = [&]() {
+        for (size_t i = nextMove++; i < divide.size(); i = nextMove++) {
+            Position next = position;
+            UndoRecord undo;
+
+            next.makeMove(divide[i].first, player, undo);
+            divide[i].second = perft(next, 3 - player, depth - 1, table.get());
+        }
+    };
+
+    int threads = std::max(1, (int) std::thread::hardware_concurrency());
+    std::vector<std::thread> helpers;
+
+    for (int i = 1; i < threads; i++)
+        helpers.push_back(std::thread(worker));
+
+    worker();
+
+    for (std::thread &helper : helpers)
+        helper.join();
+
+    return divide;
+}
+
+void perftCommand(int depth, bool divided, bool hashed, const std::string &field, const std::string &macroboard) {
+    Position position;
+
+    position.clear();
+    if (!field.empty()) {
+        position.setField(field.c_str());
+        position.setMacroboard(macroboard.c_str());
+    }
+
+    _time_t start = _clock_t::now();
+    std::vector<std::pair<int, __uint64_t> > divide = perftDivide(position, std::max(depth, 1), hashed);
+    double seconds = std::chrono::duration<double>(_clock_t::now() - start).count();
+    __uint64_t total = 0;
+
+    for (const std::pair<int, __uint64_t> &move : divide) {
+        total += move.second;
+
+        if (divided)
+            std::cout << convertToCoord(move.first).first << " " << convertToCoord(move.first).second << ": "
+                      << move.second << std::endl;
+    }
+
+    std::cout << "===========================" << std::endl
+              << "Total time (ms) : " << (long) (seconds * 1000) << std::endl
+              << "Leaf nodes      : " << total << std::endl
+              << "Nodes/second    : " << (long) (total / std::max(seconds, 1e-6)) << std::endl;
+}
+
+
+/* batch analysis */
+
+//  number of comma separated values in a token
+int countValues(const Token &token) {
+    return (int) std::count(token.begin, token.begin + token.length, ',') + 1;
+}
+
+//  one line of the analysis output, or an error for a line that is not a position
+std::string analyzeLine(long number, const std::string &line, TranspositionTable &tt,
+                        const AnalysisOptions &options) {
+    std::ostringstream result;
+    Token tokens[3];
+
+    result << number << ": ";
+
+    if (tokenize(line.c_str(), ' ', tokens, 3) != 2 || countValues(tokens[0]) != 81 || countValues(tokens[1]) != 9) {
+        result << "error not a position";
+        return result.str();
+    }
+
+    Position position;
+    position.clear();
+    position.setField(tokens[0].begin);
+    position.setMacroboard(tokens[1].begin);
+
+    if (position.gameIsFinished() || !position.getAvailableMoves()) {
+        result << "error no moves";
+        return result.str();
+    }
+
+    //  every position starts from an empty table, so its result does not depend on the others
+    tt.clear();
+
+    Search search(position, position.sideToMove(), &tt);
+    _score_t score;
+
+    if (options.nodes > 0)
+        search.limitNodes(options.nodes);
+
+    int best = search.think(std::min(options.depth, position.emptyCells()), _time_t::max(), score);
+
+    result << convertToCoord(best).first << " " << convertToCoord(best).second << " " << score << " "
+           << search.stats().depth << " " << search.nodes() << " pv";
+
+    for (int move : search.principalVariation())
+        result << " " << convertToCoord(move).first << "," << convertToCoord(move).second;
+
+    return result.str();
+}
+
+void analyze(std::istream &in, std::ostream &out, const AnalysisOptions &options) {
+    std::deque<std::pair<long, std::string> > queue;
+    std::mutex queueMutex, outMutex;
+    std::condition_variable notEmpty, notFull;
+    bool finished = false;
+
+    auto worker = [&]() {
+        TranspositionTable tt;
+        tt.resize(options.hashMb);
+
+        for (;;) {
+            std::pair<long, std::string> line;
+
+            {
+                std::unique_lock<std::mutex> lock(queueMutex);
+                notEmpty.wait(lock, [&]() { return finished || !queue.empty(); });
+
+                if (queue.empty())
+                    return;
+
+                line.first = queue.front().first;
+                line.second.swap(queue.front().second);
+                queue.pop_front();
+            }
+
+            notFull.notify_one();
+            std::string result = analyzeLine(line.first, line.second, tt, options);
+
+            std::lock_guard<std::mutex> lock(outMutex);
+            out << result << std::endl;
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (int i = 0; i < std::max(options.threads, 1); i++)
+        workers.push_back(std::thread(worker));
+
+    //  this thread only reads, and waits while the queue is full
+    std::string line;
+    long number = 0;
+
+    while (std::getline(in, line)) {
+        number++;
+
+        if (!line.empty() && line[line.size() - 1] == '\r')
+            line.erase(line.size() - 1);
+
+        if (line.empty())
+            continue;
+
+        std::unique_lock<std::mutex> lock(queueMutex);
+        notFull.wait(lock, [&]() { return queue.size() < (size_t) ANALYSIS_QUEUE; });
+
+        queue.push_back(std::make_pair(number, std::string()));
+        queue.back().second.swap(line);
+
+        lock.unlock();
+        notEmpty.notify_one();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        finished = true;
+    }
+
+    notEmpty.notify_all();
+
+    for (std::thread &thread : workers)
+        thread.join();
+}
@@ -0,0 +1,2252 @@
+/*******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 Abdulla Gaibullaev
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ ******************************************************************************/
+
+#ifndef UTTT_ENGINE_H
+#define UTTT_ENGINE_H
+
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <sstream>
+#include <time.h>
+#include <chrono>
+#include <atomic>
+#include <thread>
+#include <climits>
+#include <memory>
+#include <future>
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef std::pair<int, int> _move_t;
+
+typedef __int64_t _score_t;
+
+typedef std::chrono::steady_clock _clock_t;
+typedef _clock_t::time_point _time_t;
+
+//  81-bit cell mask: square s occupies bits [9 * s, 9 * s + 9) and cell k of a square is bit k
+//  (squares on the macroboard and cells inside a square are both numbered row by row)
+typedef unsigned __int128 _mask81_t;
+
+#define INF INT64_MAX
+
+//  statements that only feed the telemetry; without UTTT_TELEMETRY they are not compiled
+#ifdef UTTT_TELEMETRY
+#define TELEMETRY(statement) statement
+#else
+#define TELEMETRY(statement)
+#endif
+
+//  the patterns are symmetric, so they match both bit orders of a square
+constexpr int winningPatterns[] = {
+        0b111000000, 0b000111000, 0b000000111, // rows
+        0b100100100, 0b010010010, 0b001001001, // cols
+        0b100010001, 0b001010100 // diagonals
+};
+
+constexpr int SQUARE_FULL = 0b111111111;
+
+//  milliseconds kept aside for IO and the server's own overhead
+const int TIME_MARGIN = 50;
+
+//  fewest moves the rest of the timebank is spread over
+const int MIN_MOVES_LEFT = 8;
+
+#include "uttt_weights.h"
+
+//  above any heuristic score (at most 8 lines of 3 won squares, 8 * MICRO_WIN_SCORE^3);
+//  a won game scores MACRO_WIN_SCORE minus the plies it took, so sooner is better
+constexpr _score_t MACRO_WIN_SCORE = 1000000000000000LL;
+
+static_assert(8 * MICRO_WIN_SCORE * MICRO_WIN_SCORE * MICRO_WIN_SCORE < MACRO_WIN_SCORE / 2,
+              "heuristic scores reach the proven ones");
+
+//  mapping between a bit's position and corresponding cell coordinates in matrix
+constexpr std::pair<int, int> posPatterns[9] = {
+        {0, 0}, {1, 0}, {2, 0},
+        {0, 1}, {1, 1}, {2, 1},
+        {0, 2}, {1, 2}, {2, 2}
+};
+
+
+std::vector<std::string> &split(const std::string &s, char delim, std::vector<std::string> &elems);
+
+int stringToInt(const std::string &s);
+
+//  a word of a command line, pointing into the line itself
+struct Token {
+    const char *begin;
+    int length;
+
+    Token() : begin(""), length(0) {
+    }
+
+    explicit Token(const std::string &s) : begin(s.c_str()), length((int) s.size()) {
+    }
+
+    bool is(const char *word) const {
+        return strncmp(begin, word, length) == 0 && word[length] == '\0';
+    }
+
+    bool is(const std::string &word) const {
+        return (int) word.size() == length && memcmp(begin, word.data(), length) == 0;
+    }
+
+    std::string str() const {
+        return std::string(begin, length);
+    }
+};
+
+//  splits line at delim into at most max tokens, without copying; the others are left empty
+int tokenize(const char *line, char delim, Token *tokens, int max);
+
+//  decimal value at p, possibly negative; p is left after the last digit
+inline int parseInt(const char *&p) {
+    bool negative = *p == '-';
+    int value = 0;
+
+    if (negative)
+        p++;
+
+    for (; *p >= '0' && *p <= '9'; p++)
+        value = 10 * value + (*p - '0');
+
+    return negative ? -value : value;
+}
+
+
+/* 9-bit patterns */
+
+//  number of states of a square: each cell is empty or belongs to one of the players
+constexpr int SQUARE_STATES = 19683;
+
+//  everything known about one square state, so the search only has to look it up
+struct SquareInfo {
+    short score[2];         //  heuristic score of the square, for each player
+    short threats[2];       //  empty cells that would win the square, for each player
+    char winner;            //  0, 1 or 2
+    char full;              //  no empty cell left
+};
+
+extern bool winnerTable[SQUARE_FULL + 1];
+extern int posTable[SQUARE_FULL + 1];
+
+//  base 3 value of each 9-bit pattern: a state is ternary[player 1] + 2 * ternary[player 2]
+extern int ternary[SQUARE_FULL + 1];
+extern SquareInfo squareTable[SQUARE_STATES];
+
+// if one square matches a winning pattern, then its owner wins the square
+inline bool isWinner(int pattern) {
+    return winnerTable[pattern];
+}
+
+//  a square without empty cells is a draw, unless somebody won it before
+inline bool squareIsDraw(int occupied) {
+    return occupied == SQUARE_FULL;
+}
+
+//  returns the positions that complete a winning pattern for p(pattern), as a 9-bit sequence:
+//  the missing bit of every winning pattern that already matches p in two places
+inline int getPos(int p) {
+    return posTable[p];
+}
+
+inline const SquareInfo &squareInfo(int mine, int theirs) {
+    return squareTable[ternary[mine] + 2 * ternary[theirs]];
+}
+
+void initTables();
+
+
+/* 81-bit masks */
+
+const _mask81_t ALL_CELLS = ((_mask81_t) 1 << 81) - 1;
+
+inline _mask81_t cellMask(int cell) {
+    return (_mask81_t) 1 << cell;
+}
+
+inline _mask81_t squareMask(int s) {
+    return (_mask81_t) SQUARE_FULL << (9 * s);
+}
+
+//  removes the lowest cell from mask and returns it
+inline int popCell(_mask81_t &mask) {
+    __uint64_t low = (__uint64_t) mask;
+    int cell = low ? __builtin_ctzll(low) : 64 + __builtin_ctzll((__uint64_t) (mask >> 64));
+
+    mask &= mask - 1;
+    return cell;
+}
+
+inline int countCells(_mask81_t mask) {
+    return __builtin_popcountll((__uint64_t) mask) + __builtin_popcountll((__uint64_t) (mask >> 64));
+}
+
+/* random numbers */
+
+//  xorshift64*: the zobrist keys, the playouts and the match openings all
+//  draw from it, so a seed gives the same numbers everywhere
+class Random {
+
+public:
+
+    explicit Random(__uint64_t seed = 0x9E3779B97F4A7C15ULL) {
+        _state = seed;
+    }
+
+    __uint64_t next() {
+        _state ^= _state >> 12;
+        _state ^= _state << 25;
+        _state ^= _state >> 27;
+        return _state * 0x2545F4914F6CDD1DULL;
+    }
+
+private:
+
+    __uint64_t _state;
+};
+
+/* zobrist keys */
+
+extern __uint64_t zobristCells[2][81];
+extern __uint64_t zobristActive[SQUARE_FULL + 1];
+extern __uint64_t zobristSide;
+
+//  fixed seed, so hashes are the same from one run to the next
+void initZobrist();
+
+//  moves are (x, y) on the 9x9 field, cells are indexes in the 81-bit masks
+inline _move_t convertToCoord(int cell) {
+    std::pair<int, int> square = posPatterns[cell / 9];
+    std::pair<int, int> inner = posPatterns[cell % 9];
+
+    return _move_t(3 * square.first + inner.first, 3 * square.second + inner.second);
+}
+
+inline int convertToInt(_move_t move) {
+    int x = move.first, y = move.second;
+
+    return 9 * (3 * (y / 3) + x / 3) + 3 * (y % 3) + x % 3;
+}
+
+
+//  fills the tables and keys above; every program calls it before
+//  anything else, and calling it again does nothing
+void initEngine();
+
+
+/* leaf evaluation */
+
+//  square values stay within 0..MICRO_WIN_SCORE, so the product of a line
+//  (three of them) fits in 32 bits, which the vector versions rely on
+static_assert(MICRO_WIN_SCORE * MICRO_WIN_SCORE * MICRO_WIN_SCORE <= INT32_MAX, "line products overflow 32 bits");
+
+//  the lines of the macroboard: rows, columns, then diagonals
+constexpr int LINE_CELLS[8][3] = {
+        {0, 1, 2}, {3, 4, 5}, {6, 7, 8},
+        {0, 3, 6}, {1, 4, 7}, {2, 5, 8},
+        {0, 4, 8}, {6, 4, 2}
+};
+
+//  for each square, the other two squares of every line through it
+constexpr int SQUARE_LINES[9] = {3, 2, 3, 2, 4, 2, 3, 2, 3};
+constexpr int LINE_PARTNERS[9][4][2] = {
+        {{1, 2}, {3, 6}, {4, 8}},
+        {{0, 2}, {4, 7}},
+        {{0, 1}, {5, 8}, {6, 4}},
+        {{4, 5}, {0, 6}},
+        {{3, 5}, {1, 7}, {0, 8}, {6, 2}},
+        {{3, 4}, {2, 8}},
+        {{7, 8}, {0, 3}, {4, 2}},
+        {{6, 8}, {1, 4}},
+        {{6, 7}, {2, 5}, {0, 4}}
+};
+
+//  sum of the products of the 8 lines, with one player's square values
+inline _score_t lineProducts(const __int32_t values[9]) {
+    _score_t sum = 0;
+
+    for (const int *line : LINE_CELLS)
+        sum += (_score_t) values[line[0]] * values[line[1]] * values[line[2]];
+
+    return sum;
+}
+
+//  sum of the products of the lines through square s, without s itself
+inline _score_t linePartners(const __int32_t values[9], int s) {
+    _score_t sum = 0;
+
+    for (int k = 0; k < SQUARE_LINES[s]; k++)
+        sum += (_score_t) values[LINE_PARTNERS[s][k][0]] * values[LINE_PARTNERS[s][k][1]];
+
+    return sum;
+}
+
+//  lineProducts with the square values of the first player, minus the same with
+//  the values of the second: the full evaluation. The search does not call it, a
+//  position keeps its evaluation up to date move by move; the tuner evaluates its
+//  samples with it, and UTTT_CHECK_EVAL compares the kept evaluation with it
+typedef _score_t (*_eval_lines_t)(const __int32_t squares[2][9]);
+
+_score_t evaluateLinesScalar(const __int32_t squares[2][9]);
+
+//  the fastest version this cpu runs, chosen by initEngine for the tuner; scalar until then
+extern _eval_lines_t evaluateLines;
+
+//  "scalar", "sse4" or "avx2"; false, and no change, if the cpu lacks the instructions
+bool selectEvaluator(const std::string &name);
+
+const char *evaluatorName();
+
+
+/* evaluation weights */
+
+//  the constants of the evaluation as values, so uttt_tune can try others
+struct EvalWeights {
+    int cellEmpty;          //  CELL_SCORE_*
+    int cellMine;
+    int cellTheirs;
+    int microWin;           //  MICRO_WIN_SCORE
+};
+
+constexpr EvalWeights ENGINE_WEIGHTS = {CELL_SCORE_EMPTY, CELL_SCORE_MINE, CELL_SCORE_THEIRS, MICRO_WIN_SCORE};
+
+//  sum of the line products of a square, for the player with the cells mine
+_score_t squareScore(int mine, int theirs, const EvalWeights &weights);
+
+//  no negative weight, and every square value within 0..microWin,
+//  as the evaluators and SquareInfo need
+bool weightsFit(const EvalWeights &weights);
+
+//  what each square state is worth to each player, as Position::squareValues finds it
+//  with the engine weights; a state is Position::state
+struct SquareValueTable {
+    __int32_t values[SQUARE_STATES][2];
+
+    void fill(const EvalWeights &weights);
+};
+
+
+/* position */
+
+constexpr int MAX_PLY = 81;
+
+//  scores beyond this are proven wins, below its negation proven losses
+constexpr _score_t PROVEN_SCORE = MACRO_WIN_SCORE - MAX_PLY;
+
+//  everything a move changes on the position, besides its own cell
+struct UndoRecord {
+    int cell;
+    int player;
+    int won;
+    int drawn;
+    int active;
+    __int32_t values[2];    //  of the square played
+    _score_t lines[2];
+};
+
+//  only with UTTT_CHECK_EVAL: compares the incremental evaluation with a full one at every node
+#ifdef UTTT_CHECK_EVAL
+#define CHECK_EVAL(statement) statement
+#else
+#define CHECK_EVAL(statement)
+#endif
+
+
+/**
+ * Bitboard representation of the game state.
+ *
+ * Players are stored by index (player - 1). The macro masks (won, drawn, active)
+ * use the same 9-bit layout as the cells of a square.
+ *
+ * The evaluation is kept up to date by the moves: a move only changes the value of
+ * its own square, and so only the products of the lines through it.
+ */
+struct Position {
+    _mask81_t cells[2];     //  occupied cells, per player
+    int won[2];             //  squares won, per player
+    int drawn;              //  full squares without a winner
+    int active;             //  squares where the next move may be played
+    __uint64_t hash;        //  zobrist key of the cells, the side to move and the active squares
+    __int32_t values[2][9]; //  squareValues, per player
+    _score_t lines[2];      //  lineProducts of values, per player
+
+    void clear() {
+        cells[0] = cells[1] = 0;
+        won[0] = won[1] = 0;
+        drawn = 0;
+        active = SQUARE_FULL;
+        hash = computeHash();
+        computeEvaluation();
+    }
+
+    //  the evaluation from scratch, after the position is set
+    void computeEvaluation() {
+        for (int p = 0; p < 2; p++) {
+            squareValues(p + 1, values[p]);
+            lines[p] = lineProducts(values[p]);
+        }
+    }
+
+    //  heuristic value for PLAYER minus value for the opponent, read from the kept line products
+    template <int PLAYER>
+    _score_t evaluation() const {
+        return lines[PLAYER - 1] - lines[2 - PLAYER];
+    }
+
+    _score_t evaluation(int player) const {
+        return (player == 1) ? (evaluation<1>()) : (evaluation<2>());
+    }
+
+    //  the kept values and products are those of a full evaluation
+    bool evaluationIsCurrent(int player) const {
+        int opponent = (player == 1) ? (2) : (1);
+        __int32_t squares[2][9];
+
+        squareValues(player, squares[0]);
+        squareValues(opponent, squares[1]);
+
+        return memcmp(squares[0], values[player - 1], sizeof(squares[0])) == 0 &&
+               memcmp(squares[1], values[opponent - 1], sizeof(squares[1])) == 0 &&
+               lines[player - 1] == lineProducts(squares[0]) && lines[opponent - 1] == lineProducts(squares[1]) &&
+               evaluation(player) == evaluateLines(squares);
+    }
+
+    __uint64_t computeHash() const {
+        __uint64_t key = zobristActive[active];
+
+        for (int p = 0; p < 2; p++) {
+            for (_mask81_t mask = cells[p]; mask;)
+                key ^= zobristCells[p][popCell(mask)];
+        }
+
+        if (sideToMove() == 2)
+            key ^= zobristSide;
+
+        return key;
+    }
+
+    //  player 1 moves first, so player 2 is to move whenever player 1 has one cell more
+    int sideToMove() const {
+        return countCells(cells[0]) > countCells(cells[1]) ? 2 : 1;
+    }
+
+    //  9-bit pattern of player's cells in square s
+    int square(int player, int s) const {
+        return (int) (cells[player - 1] >> (9 * s)) & SQUARE_FULL;
+    }
+
+    int occupied(int s) const {
+        return square(1, s) | square(2, s);
+    }
+
+    int emptyCells() const {
+        return 81 - countCells(cells[0] | cells[1]);
+    }
+
+    bool same(const Position &other) const {
+        return cells[0] == other.cells[0] && cells[1] == other.cells[1] && active == other.active;
+    }
+
+    //  index of square s in squareTable
+    int state(int s) const {
+        return ternary[square(1, s)] + 2 * ternary[square(2, s)];
+    }
+
+    const SquareInfo &info(int s) const {
+        return squareTable[state(s)];
+    }
+
+    //  squares that cannot be played anymore
+    int closed() const {
+        return won[0] | won[1] | drawn;
+    }
+
+    bool isWinner(int player) const {
+        return ::isWinner(won[player - 1]);
+    }
+
+    //  the active squares that are still open; all open squares if a macroboard
+    //  from the server marks only closed ones as active
+    int playable() const {
+        int open = SQUARE_FULL & ~closed();
+
+        return (active & open) ? (active & open) : (open);
+    }
+
+    bool gameIsFinished() const {
+        return isWinner(1) || isWinner(2) || (SQUARE_FULL & ~closed()) == 0;
+    }
+
+    _mask81_t getAvailableMoves() const {
+        if (isWinner(1) || isWinner(2))
+            return 0;
+
+        _mask81_t moves = 0;
+
+        for (int squares = playable(); squares; squares &= squares - 1)
+            moves |= squareMask(__builtin_ctz(squares));
+
+        return moves & ~(cells[0] | cells[1]);
+    }
+
+    template <int PLAYER>
+    void simulateMove(int cell) {
+        int s = cell / 9;
+
+        //  put player on field
+        cells[PLAYER - 1] |= cellMask(cell);
+        hash ^= zobristCells[PLAYER - 1][cell] ^ zobristSide ^ zobristActive[active];
+
+        //  update macroboard
+        const SquareInfo &after = info(s);
+
+        if (after.winner)
+            won[PLAYER - 1] |= 1 << s;
+        else if (after.full)
+            drawn |= 1 << s;
+
+        //  the new value of the square, in the products of its lines
+        for (int p = 0; p < 2; p++) {
+            __int32_t value = after.winner ? ((after.winner == p + 1) ? (MICRO_WIN_SCORE) : (0)) : (after.score[p]);
+
+            lines[p] += (value - values[p][s]) * linePartners(values[p], s);
+            values[p][s] = value;
+        }
+
+        //  the opponent is sent to the square matching the cell,
+        //  or anywhere if that square cannot be played anymore
+        int sent = cell % 9;
+        int open = SQUARE_FULL & ~closed();
+
+        active = ((open >> sent) & 1) ? (1 << sent) : (open);
+        hash ^= zobristActive[active];
+    }
+
+    void simulateMove(int cell, int player) {
+        if (player == 1)
+            simulateMove<1>(cell);
+        else
+            simulateMove<2>(cell);
+    }
+
+    //  plays the move and keeps what undoMove needs to take it back
+    template <int PLAYER>
+    void makeMove(int cell, UndoRecord &undo) {
+        undo.cell = cell;
+        undo.player = PLAYER;
+        undo.won = won[PLAYER - 1];
+        undo.drawn = drawn;
+        undo.active = active;
+
+        for (int p = 0; p < 2; p++) {
+            undo.values[p] = values[p][cell / 9];
+            undo.lines[p] = lines[p];
+        }
+
+        simulateMove<PLAYER>(cell);
+    }
+
+    void makeMove(int cell, int player, UndoRecord &undo) {
+        if (player == 1)
+            makeMove<1>(cell, undo);
+        else
+            makeMove<2>(cell, undo);
+    }
+
+    void undoMove(const UndoRecord &undo) {
+        cells[undo.player - 1] &= ~cellMask(undo.cell);
+        hash ^= zobristCells[undo.player - 1][undo.cell] ^ zobristSide ^ zobristActive[active] ^ zobristActive[undo.active];
+        won[undo.player - 1] = undo.won;
+        drawn = undo.drawn;
+        active = undo.active;
+
+        for (int p = 0; p < 2; p++) {
+            values[p][undo.cell / 9] = undo.values[p];
+            lines[p] = undo.lines[p];
+        }
+    }
+
+    //  what each square is worth to player: MICRO_WIN_SCORE if won, 0 if lost,
+    //  otherwise the score of its pattern
+    void squareValues(int player, __int32_t values[9]) const {
+        int opponent = (player == 1) ? (2) : (1);
+
+        for (int s = 0; s < 9; s++) {
+            if ((won[player - 1] >> s) & 1)
+                values[s] = MICRO_WIN_SCORE;
+            else if ((won[opponent - 1] >> s) & 1)
+                values[s] = 0;
+            else
+                values[s] = info(s).score[player - 1];
+        }
+    }
+
+    //  field as sent by the server: 81 comma separated values, row by row
+    void setField(const char *field) {
+        cells[0] = cells[1] = 0;
+
+        for (int i = 0; i < 81 && *field; i++) {
+            int value = parseInt(field);
+
+            if (value == 1 || value == 2)
+                cells[value - 1] |= cellMask(convertToInt(_move_t(i % 9, i / 9)));
+
+            if (*field == ',')
+                field++;
+        }
+
+        won[0] = won[1] = 0;
+        drawn = 0;
+
+        for (int s = 0; s < 9; s++) {
+            const SquareInfo &square = info(s);
+
+            if (square.winner)
+                won[square.winner - 1] |= 1 << s;
+            else if (square.full)
+                drawn |= 1 << s;
+        }
+
+        hash = computeHash();
+        computeEvaluation();
+    }
+
+    //  macroboard as sent by the server: -1 marks the squares that may be played
+    void setMacroboard(const char *macroboard) {
+        active = 0;
+
+        for (int s = 0; s < 9 && *macroboard; s++) {
+            if (parseInt(macroboard) == -1)
+                active |= 1 << s;
+
+            if (*macroboard == ',')
+                macroboard++;
+        }
+
+        hash = computeHash();
+    }
+};
+
+
+/* transposition table */
+
+enum _bound_t {
+    BOUND_NONE, BOUND_UPPER, BOUND_LOWER, BOUND_EXACT
+};
+
+//  what the table knows about a position
+struct TTEntry {
+    _score_t score;
+    int move;               //  best move (cell), -1 if none
+    int depth;
+    _bound_t bound;
+};
+
+//  16 bytes, so a bucket of four fills one cache line
+//
+//  Threads read and write slots without locks. The key check is stored xor-ed with
+//  the rest of the slot, so a slot torn by two writers fails the check and is ignored.
+struct TTSlot {
+    std::atomic<__uint64_t> data;   //  score
+    std::atomic<__uint64_t> meta;   //  key check (32 bits) | generation | bound | depth | move (8 bits each)
+};
+
+const int TT_BUCKET_SIZE = 4;
+
+struct TTBucket {
+    TTSlot slots[TT_BUCKET_SIZE];
+};
+
+const int DEFAULT_HASH_MB = 32;
+
+//  proven scores count plies from the root, the table counts them from the position
+inline _score_t scoreToTable(_score_t score, int ply) {
+    return (score >= PROVEN_SCORE) ? (score + ply) : ((score <= -PROVEN_SCORE) ? (score - ply) : (score));
+}
+
+inline _score_t scoreFromTable(_score_t score, int ply) {
+    return (score >= PROVEN_SCORE) ? (score - ply) : ((score <= -PROVEN_SCORE) ? (score + ply) : (score));
+}
+
+/**
+ * Fixed-size hash table of searched positions, shared by consecutive searches
+ * and by the threads of a parallel search.
+ *
+ * Scores are stored from the point of view of the player to move, as negamax returns them.
+ */
+class TranspositionTable {
+
+public:
+
+    TranspositionTable() {
+        _buckets = NULL;
+        _mask = 0;
+        _generation = 0;
+        resize(DEFAULT_HASH_MB);
+    }
+
+    ~TranspositionTable() {
+        free(_buckets);
+    }
+
+    //  the number of buckets is rounded down to a power of two
+    void resize(int mb) {
+        size_t count = 1;
+
+        while (2 * count * sizeof(TTBucket) <= (size_t) (mb > 1 ? mb : 1) << 20)
+            count *= 2;
+
+        void *memory = NULL;
+        if (posix_memalign(&memory, sizeof(TTBucket), count * sizeof(TTBucket)) != 0)
+            return;
+
+        free(_buckets);
+        _buckets = (TTBucket *) memory;
+        _mask = count - 1;
+        clear();
+    }
+
+    void clear() {
+        for (size_t b = 0; b <= _mask; b++) {
+            for (TTSlot &slot : _buckets[b].slots) {
+                slot.data.store(0, std::memory_order_relaxed);
+                slot.meta.store(0, std::memory_order_relaxed);
+            }
+        }
+
+        _generation = 0;
+    }
+
+    //  entries stored during older searches are replaced first
+    void newSearch() {
+        _generation++;
+    }
+
+    //  fills entry and returns true if the table knows the position
+    bool probe(__uint64_t hash, TTEntry &entry) const {
+        const TTBucket &bucket = _buckets[hash & _mask];
+        __uint32_t key = (__uint32_t) (hash >> 32);
+
+        for (const TTSlot &slot : bucket.slots) {
+            __uint64_t data = slot.data.load(std::memory_order_relaxed);
+            __uint64_t meta = slot.meta.load(std::memory_order_relaxed);
+
+            if (slotKey(data, meta) == key && ((meta >> 16) & 0xFF) != BOUND_NONE) {
+                entry.score = (_score_t) data;
+                entry.move = (__int8_t) (meta & 0xFF);
+                entry.depth = (int) ((meta >> 8) & 0xFF);
+                entry.bound = (_bound_t) ((meta >> 16) & 0xFF);
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    void store(__uint64_t hash, int depth, _bound_t bound, _score_t score, int move) {
+        TTBucket &bucket = _buckets[hash & _mask];
+        __uint32_t key = (__uint32_t) (hash >> 32);
+
+        //  same position, else the shallowest entry of an older search, else the shallowest entry
+        TTSlot *replace = NULL;
+        int replaceWorth = 0;
+        __uint64_t replaceMeta = 0;
+
+        for (TTSlot &slot : bucket.slots) {
+            __uint64_t meta = slot.meta.load(std::memory_order_relaxed);
+
+            if (slotKey(slot.data.load(std::memory_order_relaxed), meta) == key) {
+                replace = &slot;
+                replaceMeta = meta;
+                break;
+            }
+
+            int worth = (int) ((meta >> 8) & 0xFF) - ((((meta >> 24) & 0xFF) == _generation) ? (0) : (256));
+
+            if (replace == NULL || worth < replaceWorth) {
+                replace = &slot;
+                replaceWorth = worth;
+            }
+        }
+
+        //  keep the best move of a shallower search of the same position
+        if (move < 0 && slotKey(replace->data.load(std::memory_order_relaxed), replaceMeta) == key)
+            move = (__int8_t) (replaceMeta & 0xFF);
+
+        __uint64_t data = (__uint64_t) score;
+        __uint64_t meta = (__uint64_t) (__uint8_t) move | (__uint64_t) (__uint8_t) depth << 8 |
+                          (__uint64_t) bound << 16 | (__uint64_t) _generation << 24;
+
+        meta |= (__uint64_t) (key ^ fold(data) ^ (__uint32_t) meta) << 32;
+
+        replace->data.store(data, std::memory_order_relaxed);
+        replace->meta.store(meta, std::memory_order_relaxed);
+    }
+
+private:
+
+    static __uint32_t fold(__uint64_t data) {
+        return (__uint32_t) data ^ (__uint32_t) (data >> 32);
+    }
+
+    static __uint32_t slotKey(__uint64_t data, __uint64_t meta) {
+        return (__uint32_t) (meta >> 32) ^ fold(data) ^ (__uint32_t) meta;
+    }
+
+    TranspositionTable(const TranspositionTable &);
+    TranspositionTable &operator=(const TranspositionTable &);
+
+    TTBucket *_buckets;
+    size_t _mask;
+    __uint8_t _generation;
+};
+
+
+/* search statistics */
+
+//  what one search did, summed over its threads; the counters stay 0 without UTTT_TELEMETRY
+struct SearchStats {
+    int depth;              //  last completed iteration
+    long nodes;
+    long iterationNodes[2]; //  nodes of the last two completed iterations, main thread
+    long evals;             //  leaf evaluations
+    long cutoffs;           //  beta cutoffs
+    long firstCutoffs;      //  cutoffs by the first move searched
+    long ttProbes;
+    long ttHits;            //  probes that found the position
+
+    void clear() {
+        memset(this, 0, sizeof(*this));
+    }
+
+    void addCounters(const SearchStats &other) {
+        evals += other.evals;
+        cutoffs += other.cutoffs;
+        firstCutoffs += other.firstCutoffs;
+        ttProbes += other.ttProbes;
+        ttHits += other.ttHits;
+    }
+
+    //  nodes of the last iteration per node of the one before
+    double branchingFactor() const {
+        return (iterationNodes[0] > 0) ? ((double) iterationNodes[1] / iterationNodes[0]) : (0);
+    }
+};
+
+
+/* move ordering */
+
+const int ORDER_HASH_MOVE = 1 << 30;
+const int ORDER_WIN_SQUARE = 1 << 29;
+const int ORDER_KILLER = 1 << 28;
+const int ORDER_FREE_MOVE = -(1 << 28);
+
+//  history scores are halved once one of them gets this large
+const int HISTORY_MAX = 1 << 24;
+
+//  moves (cells) in a fixed array, so that lists of moves never touch the heap
+struct MoveList {
+    int moves[81];
+    int count;
+
+    MoveList() : count(0) {
+    }
+
+    void push_back(int cell) {
+        moves[count++] = cell;
+    }
+
+    size_t size() const {
+        return (size_t) count;
+    }
+
+    bool empty() const {
+        return count == 0;
+    }
+
+    int &operator[](size_t i) {
+        return moves[i];
+    }
+
+    int *begin() {
+        return moves;
+    }
+
+    int *end() {
+        return moves + count;
+    }
+};
+
+/**
+ * Hands out the moves of one node, best candidates first:
+ *
+ *      > the hash move (best move stored in the transposition table)
+ *      > moves that win a square
+ *      > killer moves of this ply
+ *      > the rest, by history score
+ *
+ * Moves that send the opponent to a closed square (a free move) come last in their group.
+ */
+class MovePicker {
+
+public:
+
+    MovePicker(const Position &position, int player, int hashMove, const int killers[2], const int history[81]) {
+        int closed = position.closed();
+        int winning[9] = {0};
+
+        for (int squares = position.playable(); squares; squares &= squares - 1) {
+            int s = __builtin_ctz(squares);
+            winning[s] = position.info(s).threats[player - 1];
+        }
+
+        _count = 0;
+        _winning = 0;
+        _free = 0;
+
+        for (_mask81_t available = position.getAvailableMoves(); available;) {
+            int cell = popCell(available);
+            int s = cell / 9, sent = cell % 9;
+            int score;
+
+            //  closed squares after this move, to know where the opponent is sent
+            int closedAfter = closed;
+
+            if ((winning[s] >> sent) & 1) {
+                closedAfter |= 1 << s;
+                _winning |= cellMask(cell);
+            }
+            else if (squareIsDraw(position.occupied(s) | (1 << sent))) {
+                closedAfter |= 1 << s;
+            }
+
+            if (cell == hashMove)
+                score = ORDER_HASH_MOVE;
+            else if ((winning[s] >> sent) & 1)
+                score = ORDER_WIN_SQUARE;
+            else if (cell == killers[0])
+                score = ORDER_KILLER + 1;
+            else if (cell == killers[1])
+                score = ORDER_KILLER;
+            else
+                score = history[cell];
+
+            if ((closedAfter >> sent) & 1)
+                _free |= cellMask(cell);
+
+            if (cell != hashMove && ((closedAfter >> sent) & 1))
+                score += ORDER_FREE_MOVE;
+
+            _moves[_count] = cell;
+            _scores[_count] = score;
+            _count++;
+        }
+    }
+
+    //  next move (cell) to search, -1 once all were handed out
+    int next() {
+        if (_count == 0)
+            return -1;
+
+        int best = 0;
+
+        for (int i = 1; i < _count; i++) {
+            if (_scores[i] > _scores[best])
+                best = i;
+        }
+
+        int cell = _moves[best];
+
+        _count--;
+        _moves[best] = _moves[_count];
+        _scores[best] = _scores[_count];
+
+        return cell;
+    }
+
+    //  moves that win a square are not remembered as killers
+    bool winsSquare(int cell) const {
+        return (_winning & cellMask(cell)) != 0;
+    }
+
+    //  the opponent may answer anywhere
+    bool givesFreeMove(int cell) const {
+        return (_free & cellMask(cell)) != 0;
+    }
+
+    //  moves that change the macroboard or let the opponent choose the square
+    bool isForcing(int cell) const {
+        return ((_winning | _free) & cellMask(cell)) != 0;
+    }
+
+private:
+    int _moves[81];
+    int _scores[81];
+    int _count;
+    _mask81_t _winning;
+    _mask81_t _free;
+};
+
+
+/* selective search */
+
+//  each can be switched off, to measure what it brings
+enum _feature_t {
+    FEATURE_LMR = 1,            //  late quiet moves are searched shallower first
+    FEATURE_FUTILITY = 2,       //  quiet moves are skipped near the leaves when far below alpha
+    FEATURE_RAZORING = 4,       //  nodes far below alpha near the leaves get a shallower search
+    FEATURE_EXTENSIONS = 8,     //  moves winning a square are searched one ply deeper
+    FEATURE_ALL = 15,
+    FEATURE_DEFAULT = FEATURE_LMR | FEATURE_FUTILITY
+};
+
+//  the features of the searches started from now on
+extern int searchFeatures;
+
+//  names separated by ',' or '+' (lmr, futility, razoring, extensions), "all", "default"
+//  or "none"; -1 for an unknown name
+int parseFeatures(const std::string &names);
+
+std::string featureNames(int features);
+
+//  late move reductions: from this depth, after this many moves, by one ply,
+//  or two after LMR_DEEP_MOVES
+const int LMR_DEPTH = 3;
+const int LMR_MOVES = 3;
+const int LMR_DEEP_MOVES = 8;
+
+//  margins by remaining depth, in evaluation units
+const int FUTILITY_DEPTH = 2;
+const _score_t FUTILITY_MARGIN[FUTILITY_DEPTH + 1] = {0, 200000, 600000};
+
+const int RAZOR_DEPTH = 2;
+const _score_t RAZOR_MARGIN[RAZOR_DEPTH + 1] = {0, 400000, 1000000};
+
+//  square wins are extended this close to the leaves, until a line is
+//  EXTENSION_LIMIT times as long as the iteration's depth
+const int EXTENSION_DEPTH = 1;
+const int EXTENSION_LIMIT = 2;
+
+
+/* aspiration windows */
+
+//  iterations from this depth on start with a window around the score two iterations
+//  before, ASPIRATION_WINDOW either side of it
+const int ASPIRATION_DEPTH = 4;
+const _score_t ASPIRATION_WINDOW = 1024;
+
+
+/**
+ * Search state: a position changed in place by makeMove / unmakeMove.
+ *
+ * It holds no IO state, so several searches can live side by side
+ * (each with its own transposition table).
+ */
+class Search {
+
+public:
+
+    Search(const Position &position, int botId, TranspositionTable *tt) {
+        _position = position;
+        _tt = tt;
+        _botId = botId;
+        _ply = 0;
+        _nodes = 0;
+        _abort = NULL;
+        _checkTime = false;
+        _stopped = false;
+        _searchMoves = ALL_CELLS;
+        _nodeLimit = LONG_MAX;
+        _features = searchFeatures;
+        _rootDepth = 0;
+        _verbose = false;
+        _stats.clear();
+        _rootPv.reserve(MAX_PLY + 1);
+
+        memset(_history, 0, sizeof(_history));
+        clearKillers();
+    }
+
+    void clearKillers() {
+        for (int ply = 0; ply < MAX_PLY; ply++)
+            _killers[ply][0] = _killers[ply][1] = -1;
+    }
+
+    const Position &position() const {
+        return _position;
+    }
+
+    //  the root moves to choose from, e.g. without the moves proven to lose
+    void restrictRoot(_mask81_t moves) {
+        _searchMoves = moves;
+    }
+
+    //  FEATURE_* of the selective search
+    void setFeatures(int features) {
+        _features = features;
+    }
+
+    //  stops the search after about this many nodes, like the deadline
+    //  it never interrupts the first iteration
+    void limitNodes(long nodes) {
+        _nodeLimit = nodes;
+    }
+
+    //  a line on stderr per completed iteration; off by default, so tools and tests stay quiet
+    void setVerbose(bool verbose) {
+        _verbose = verbose;
+    }
+
+    template <int PLAYER>
+    void makeMove(int cell) {
+        _position.makeMove<PLAYER>(cell, _undo[_ply++]);
+    }
+
+    void unmakeMove() {
+        _position.undoMove(_undo[--_ply]);
+    }
+
+
+    /* iterative deepening */
+
+    //  searches one more ply at a time until the deadline and returns the best move (cell)
+    //  of the last completed iteration; the first iteration always completes,
+    //  so even an exhausted timebank gets a move
+    int think(int maxDepth, _time_t deadline, _score_t &score, const std::atomic<bool> *abort = NULL) {
+        _time_t start = _clock_t::now();
+
+        score = 0;
+        startSearch(deadline, abort);
+
+        MoveList moves = rootMoves();
+        int bestMove = moves.empty() ? (-1) : (moves[0]);
+
+        //  scores swing between odd and even depths, so the window is centred
+        //  on the last score of the same parity
+        _score_t parityScores[2] = {0, 0};
+
+        _rootPv.clear();
+
+        for (int depth = 1; depth <= maxDepth && !moves.empty(); depth++) {
+            _score_t iterationScore;
+            long iterationStart = _nodes;
+            int move = aspirationSearch(moves, depth, parityScores[depth % 2], iterationScore);
+
+            if (_stopped)
+                break;
+
+            bestMove = move;
+            score = iterationScore;
+            parityScores[depth % 2] = score;
+            _rootPv.assign(_pv[0], _pv[0] + _pvLength[0]);
+            _checkTime = true;
+
+            _stats.depth = depth;
+            _stats.iterationNodes[0] = _stats.iterationNodes[1];
+            _stats.iterationNodes[1] = _nodes - iterationStart;
+
+            _time_t now = _clock_t::now();
+
+            if (_verbose)
+                printIteration(depth, bestMove, score, now - start);
+
+            //  the next iteration takes longer than all the previous ones together,
+            //  so it would not finish in the time left
+            if (now - start > (deadline - now))
+                break;
+        }
+
+        return bestMove;
+    }
+
+    //  helper of a parallel search: searches until aborted, only to fill the shared table.
+    //  Helpers start on different depths and first moves, so they do not all repeat the main search
+    void help(int maxDepth, int id, const std::atomic<bool> *abort) {
+        startSearch(_clock_t::now(), abort);
+
+        MoveList moves = rootMoves();
+
+        if (!moves.empty())
+            std::rotate(moves.begin(), moves.begin() + (id / 2) % moves.size(), moves.end());
+
+        for (int depth = 1 + id % 2; depth <= maxDepth && !_stopped && !moves.empty(); depth++) {
+            _score_t score;
+            searchRoot(moves, depth, -INF, INF, score);
+        }
+    }
+
+    void startSearch(_time_t deadline, const std::atomic<bool> *abort) {
+        _deadline = deadline;
+        _abort = abort;
+        _nodes = 0;
+        _checkTime = false;
+        _stopped = false;
+        _stats.clear();
+
+        clearKillers();
+        ageHistory();
+    }
+
+    //  root moves in the same order as inner nodes, the table's move first
+    MoveList rootMoves() {
+        TTEntry entry;
+        int hashMove = _tt->probe(_position.hash, entry) ? (entry.move) : (-1);
+        MovePicker picker(_position, _botId, hashMove, _killers[_ply], _history[_botId - 1]);
+
+        MoveList moves;
+        for (int m = picker.next(); m != -1; m = picker.next()) {
+            if (_searchMoves & cellMask(m))
+                moves.push_back(m);
+        }
+
+        return moves;
+    }
+
+    //  one iteration, first with a window around an earlier score; a score outside
+    //  the window is only a bound, so the window widens on that side and the root is searched again
+    int aspirationSearch(MoveList &moves, int depth, _score_t previous, _score_t &score) {
+        _score_t delta = ASPIRATION_WINDOW;
+        _score_t alpha = -INF;
+        _score_t beta = INF;
+
+        if (depth >= ASPIRATION_DEPTH && previous > -PROVEN_SCORE && previous < PROVEN_SCORE) {
+            alpha = previous - delta;
+            beta = previous + delta;
+        }
+
+        for (;;) {
+            int move = searchRoot(moves, depth, alpha, beta, score);
+
+            if (_stopped)
+                return -1;
+
+            if (score > alpha && score < beta)
+                return move;
+
+            delta *= 4;
+
+            if (score <= alpha)
+                alpha = (delta < MACRO_WIN_SCORE) ? (previous - delta) : (-INF);
+            else
+                beta = (delta < MACRO_WIN_SCORE) ? (previous + delta) : (INF);
+        }
+    }
+
+    //  searches the root moves like an inner node, within (alpha, beta), and returns the best one,
+    //  which is moved first for the next iteration
+    int searchRoot(MoveList &moves, int depth, _score_t alpha, _score_t beta, _score_t &score) {
+        size_t best = 0;
+
+        score = -INF;
+        _pvLength[0] = 0;
+        _rootDepth = depth;
+
+        for (size_t i = 0; i < moves.size(); i++) {
+            //  calculate this move's score; the only place the side to move is a runtime value
+            _score_t currentScore = (_botId == 1) ? (searchMove<1>(moves[i], i == 0, depth, alpha, beta))
+                                                  : (searchMove<2>(moves[i], i == 0, depth, alpha, beta));
+
+            if (_stopped)
+                return -1;
+
+            //  update general score and move
+            if (currentScore > score) {
+                score = currentScore;
+                best = i;
+
+                if (score > alpha) {
+                    alpha = score;
+                    updatePv(moves[i]);
+
+                    if (alpha >= beta)
+                        break;
+                }
+            }
+        }
+
+        std::rotate(moves.begin(), moves.begin() + best, moves.begin() + best + 1);
+        return moves[0];
+    }
+
+    bool stopped() const {
+        return _stopped;
+    }
+
+    long nodes() const {
+        return _nodes;
+    }
+
+    const SearchStats &stats() const {
+        return _stats;
+    }
+
+    //  the expected line of play, from the best move of the last completed iteration;
+    //  its capacity is reserved, so searches never grow it
+    const std::vector<int> &principalVariation() const {
+        return _rootPv;
+    }
+
+    //  "depth <d>: <x> <y> <score> (<nodes> nodes, <ms> ms) pv <x,y>..."
+    void printIteration(int depth, int bestMove, _score_t score, _clock_t::duration elapsed) const {
+        std::cerr << "depth " << depth << ": " << convertToCoord(bestMove).first << " "
+                  << convertToCoord(bestMove).second << " " << score << " (" << _nodes << " nodes, "
+                  << std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count() << " ms) pv";
+
+        for (int cell : _rootPv)
+            std::cerr << " " << convertToCoord(cell).first << "," << convertToCoord(cell).second;
+
+        std::cerr << std::endl;
+    }
+
+
+    /* negamax */
+
+    //  the search is instantiated for each side to move, and the instantiations call each other
+    //  ply after ply, so the player is a constant in every node
+
+    //  plays the root move for PLAYER, searches it and takes it back
+    template <int PLAYER>
+    _score_t searchMove(int cell, bool first, int depth, _score_t alpha, _score_t beta) {
+        makeMove<PLAYER>(cell);
+        _score_t score = searchChild<3 - PLAYER>(first, depth, 0, alpha, beta);
+        unmakeMove();
+
+        return score;
+    }
+
+    //  negamax alpha-beta: scores are from the point of view of PLAYER, the player to move
+    template <int PLAYER>
+    _score_t negamax(int depth, _score_t alpha, _score_t beta) {
+        _pvLength[_ply] = _ply;
+
+        //  poll the clock and the other threads every few thousand nodes
+        if ((++_nodes & 4095) == 0 &&
+            ((_checkTime && (_nodes >= _nodeLimit || _clock_t::now() >= _deadline)) ||
+             (_abort && _abort->load(std::memory_order_relaxed))))
+            _stopped = true;
+
+        if (_stopped)
+            return 0;
+
+        CHECK_EVAL(checkEvaluation(PLAYER));
+
+        if (_position.gameIsFinished())
+            return terminalScore<PLAYER>();
+
+        if (depth == 0) {
+            TELEMETRY(_stats.evals++);
+            return evaluate<PLAYER>();
+        }
+
+        //  the table answers if this position was already searched deep enough;
+        //  not on the principal variation, which would lose its continuation
+        bool pvNode = alpha + 1 < beta;
+        TTEntry entry;
+        int hashMove = -1;
+
+        TELEMETRY(_stats.ttProbes++);
+
+        if (_tt->probe(_position.hash, entry)) {
+            TELEMETRY(_stats.ttHits++);
+            entry.score = scoreFromTable(entry.score, _ply);
+
+            if (!pvNode && entry.depth >= depth &&
+                (entry.bound == BOUND_EXACT ||
+                 (entry.bound == BOUND_LOWER && entry.score >= beta) ||
+                 (entry.bound == BOUND_UPPER && entry.score <= alpha)))
+                return entry.score;
+
+            hashMove = entry.move;
+        }
+
+        //  near the leaves, a static evaluation far below alpha prunes or shortens the search;
+        //  never on the principal variation or close to a proven result
+        bool prunable = !pvNode && alpha > -PROVEN_SCORE && beta < PROVEN_SCORE;
+        _score_t staticScore = prunable ? (evaluate<PLAYER>()) : (0);
+
+        if (prunable && (_features & FEATURE_RAZORING) && depth <= RAZOR_DEPTH &&
+            staticScore + RAZOR_MARGIN[depth] <= alpha) {
+            _score_t razored = negamax<PLAYER>(depth - 1, alpha, beta);
+
+            if (razored <= alpha || _stopped)
+                return razored;
+        }
+
+        bool futile = prunable && (_features & FEATURE_FUTILITY) && depth <= FUTILITY_DEPTH &&
+                      staticScore + FUTILITY_MARGIN[depth] <= alpha;
+
+        //  the window actually searched, which decides the bound of the result
+        _score_t alphaOrig = alpha;
+
+        _score_t score = -INF;
+        int bestMove = -1;
+        int searched = 0;
+
+        MovePicker picker(_position, PLAYER, hashMove, _killers[_ply], _history[PLAYER - 1]);
+
+        //  for each available move m, best candidates first
+        for (int m = picker.next(); m != -1; m = picker.next()) {
+            bool forcing = picker.isForcing(m);
+
+            if (futile && searched > 0 && !forcing)
+                continue;
+
+            searched++;
+
+            int extension = ((_features & FEATURE_EXTENSIONS) && picker.winsSquare(m) && depth <= EXTENSION_DEPTH &&
+                             _ply + depth < EXTENSION_LIMIT * _rootDepth) ? (1) : (0);
+            int reduction = 0;
+
+            if ((_features & FEATURE_LMR) && depth >= LMR_DEPTH && searched > LMR_MOVES && !forcing &&
+                m != _killers[_ply][0] && m != _killers[_ply][1])
+                reduction = (searched > LMR_DEEP_MOVES && depth > LMR_DEPTH) ? (2) : (1);
+
+            makeMove<PLAYER>(m);
+            _score_t currentScore = searchChild<3 - PLAYER>(searched == 1, depth + extension, reduction, alpha, beta);
+            unmakeMove();
+
+            if (_stopped)
+                return 0;
+
+            if (currentScore > score) {
+                score = currentScore;
+                bestMove = m;
+
+                if (score > alpha) {
+                    alpha = score;
+                    updatePv(m);
+
+                    //  pruning
+                    if (alpha >= beta) {
+                        TELEMETRY(_stats.cutoffs++);
+                        TELEMETRY(_stats.firstCutoffs += (searched == 1));
+                        rememberCutoff(m, PLAYER, depth, picker);
+                        break;
+                    }
+                }
+            }
+        }
+
+        _bound_t bound = (score <= alphaOrig) ? (BOUND_UPPER) : ((score >= beta) ? (BOUND_LOWER) : (BOUND_EXACT));
+        _tt->store(_position.hash, depth, bound, scoreToTable(score, _ply), bestMove);
+
+        return score;
+    }
+
+    //  principal variation search of the move just made: the first move gets the whole window,
+    //  the others a null window that only proves they are not better, and the whole window
+    //  again if they are. A reduced move that beats alpha is searched again at full depth
+    //  PLAYER is the player to move after it
+    template <int PLAYER>
+    _score_t searchChild(bool first, int depth, int reduction, _score_t alpha, _score_t beta) {
+        if (first)
+            return -negamax<PLAYER>(depth - 1, -beta, -alpha);
+
+        _score_t score = -negamax<PLAYER>(depth - 1 - reduction, -alpha - 1, -alpha);
+
+        if (reduction > 0 && score > alpha && !_stopped)
+            score = -negamax<PLAYER>(depth - 1, -alpha - 1, -alpha);
+
+        if (score > alpha && score < beta && !_stopped)
+            score = -negamax<PLAYER>(depth - 1, -beta, -alpha);
+
+        return score;
+    }
+
+    //  the move at this ply followed by the line of the child that returned it
+    void updatePv(int move) {
+        _pv[_ply][_ply] = move;
+
+        for (int i = _ply + 1; i < _pvLength[_ply + 1]; i++)
+            _pv[_ply][i] = _pv[_ply + 1][i];
+
+        _pvLength[_ply] = std::max(_pvLength[_ply + 1], _ply + 1);
+    }
+
+    //  a move that caused a cutoff is tried early in the sibling nodes (killer)
+    //  and wherever it is available later (history)
+    void rememberCutoff(int cell, int player, int depth, const MovePicker &picker) {
+        if (!picker.winsSquare(cell) && _killers[_ply][0] != cell) {
+            _killers[_ply][1] = _killers[_ply][0];
+            _killers[_ply][0] = cell;
+        }
+
+        int *history = _history[player - 1];
+        history[cell] += depth * depth;
+
+        if (history[cell] > HISTORY_MAX)
+            ageHistory();
+    }
+
+    void ageHistory() {
+        for (int p = 0; p < 2; p++) {
+            for (int cell = 0; cell < 81; cell++)
+                _history[p][cell] /= 2;
+        }
+    }
+
+
+    //  a finished game is worth what it proves, whatever the heuristics say
+    template <int PLAYER>
+    _score_t terminalScore() {
+        if (_position.isWinner(PLAYER))
+            return MACRO_WIN_SCORE - _ply;
+
+        if (_position.isWinner(3 - PLAYER))
+            return -(MACRO_WIN_SCORE - _ply);
+
+        return 0;
+    }
+
+
+    /* heuristics */
+
+#ifdef UTTT_CHECK_EVAL
+    void checkEvaluation(int player) const {
+        if (!_position.evaluationIsCurrent(player)) {
+            std::cerr << "incremental evaluation differs at ply " << _ply << ", hash " << _position.hash << std::endl;
+            abort();
+        }
+    }
+#endif
+
+    //  the position for player minus the position for the opponent, by the lines of the macroboard
+    template <int PLAYER>
+    _score_t evaluate() {
+        return _position.evaluation<PLAYER>();
+    }
+
+private:
+    Position _position;
+    TranspositionTable *_tt;
+    int _botId;
+
+    long _nodes;
+    _time_t _deadline;
+    const std::atomic<bool> *_abort;
+    bool _checkTime;
+    bool _stopped;
+    _mask81_t _searchMoves;
+    long _nodeLimit;
+    int _features;
+    int _rootDepth;
+    bool _verbose;
+    SearchStats _stats;
+
+    UndoRecord _undo[MAX_PLY];
+    int _ply;
+
+    //  triangular table of the lines found at each ply
+    int _pv[MAX_PLY + 1][MAX_PLY + 1];
+    int _pvLength[MAX_PLY + 1];
+    std::vector<int> _rootPv;
+
+    //  move ordering
+    int _killers[MAX_PLY][2];
+    int _history[2][81];
+};
+
+
+
+//  threads that can run at once: more only take cpu time from the main search,
+//  so a single or oversubscribed core would search shallower than with one thread
+int searchThreads(int requested);
+
+/**
+ * Lazy SMP: helper threads search the same root and share what they find through the
+ * transposition table; the main search alone watches the clock and decides the move.
+ * At most searchThreads(threads) threads run.
+ */
+int parallelThink(const Position &position, int botId, TranspositionTable *tt, int threads,
+                  int maxDepth, _time_t deadline, _score_t &score, long &nodes,
+                  const std::atomic<bool> *stop = NULL, _mask81_t searchMoves = ALL_CELLS,
+                  SearchStats *stats = NULL, int features = searchFeatures, bool verbose = false);
+
+
+/* endgame solver */
+
+//  game results, for the side to move
+enum _wdl_t {
+    WDL_LOSS = -1, WDL_DRAW = 0, WDL_WIN = 1
+};
+
+const char *const WDL_NAMES[] = {"loss", "draw", "win"};
+
+//  what is proven about one position: its result lies in [lower, upper]
+struct WDLSlot {
+    __uint64_t key;
+    __int8_t lower;
+    __int8_t upper;
+};
+
+const int DEFAULT_WDL_MB = 16;
+
+/**
+ * Proven bounds of solved positions, apart from the transposition table: they hold at
+ * any depth and never go stale, so the cache is kept from one move to the next.
+ */
+class WDLCache {
+
+public:
+
+    WDLCache() {
+        resize(DEFAULT_WDL_MB);
+    }
+
+    void resize(int mb) {
+        size_t count = 1;
+
+        while (2 * count * sizeof(WDLSlot) <= (size_t) (mb > 1 ? mb : 1) << 20)
+            count *= 2;
+
+        //  a new vector, as assign would keep the memory of a larger cache
+        std::vector<WDLSlot>(count, WDLSlot()).swap(_slots);
+        _mask = count - 1;
+        clear();
+    }
+
+    void clear() {
+        for (WDLSlot &slot : _slots) {
+            slot.key = 0;
+            slot.lower = WDL_LOSS;
+            slot.upper = WDL_WIN;
+        }
+    }
+
+    bool probe(__uint64_t hash, int &lower, int &upper) const {
+        const WDLSlot &slot = _slots[hash & _mask];
+
+        if (slot.key != hash)
+            return false;
+
+        lower = slot.lower;
+        upper = slot.upper;
+        return true;
+    }
+
+    void store(__uint64_t hash, int lower, int upper) {
+        WDLSlot &slot = _slots[hash & _mask];
+
+        slot.key = hash;
+        slot.lower = (__int8_t) lower;
+        slot.upper = (__int8_t) upper;
+    }
+
+private:
+
+    std::vector<WDLSlot> _slots;
+    size_t _mask;
+};
+
+//  the solver's verdict on the root: the best proven move, and the moves proven to lose
+struct SolverResult {
+    int move;               //  cell, -1 if no move is proven better than a loss
+    int result;             //  _wdl_t of move
+    bool complete;          //  every root move was solved, or a win was found
+    _mask81_t losing;
+    long nodes;
+};
+
+/**
+ * Exact win/draw/loss search for the last plies of a game.
+ *
+ * Every search is a null-window alpha-beta on the results -1, 0 and 1:
+ * each root move is asked "does it win?" and, if not, "does it lose?".
+ */
+class Solver {
+
+public:
+
+    explicit Solver(WDLCache *cache) {
+        _cache = cache;
+        _nodes = 0;
+        _stopped = false;
+    }
+
+    SolverResult solveRoot(const Position &position, int player, _time_t deadline) {
+        SolverResult result = {-1, WDL_LOSS, false, 0, 0};
+
+        _position = position;
+        _deadline = deadline;
+        _stopped = false;
+
+        _mask81_t moves = orderedMoves(player);
+        int solved = 0, total = countCells(moves);
+
+        for (int i = 0; i < total && !_stopped; i++) {
+            int cell = _ordered[0][i];
+            UndoRecord undo;
+
+            _position.makeMove(cell, player, undo);
+            //  my windows (0, 1), then (-1, 0), seen from the opponent
+            int win = -solve(-WDL_WIN, -WDL_DRAW, 3 - player, 1);
+            int draw = (win >= WDL_WIN || _stopped) ? (win) : (-solve(-WDL_DRAW, -WDL_LOSS, 3 - player, 1));
+            _position.undoMove(undo);
+
+            if (_stopped)
+                break;
+
+            solved++;
+
+            if (win >= WDL_WIN) {
+                result.move = cell;
+                result.result = WDL_WIN;
+                result.complete = true;
+                break;
+            }
+
+            if (draw >= WDL_DRAW) {
+                if (result.move < 0) {
+                    result.move = cell;
+                    result.result = WDL_DRAW;
+                }
+            }
+            else {
+                result.losing |= cellMask(cell);
+            }
+        }
+
+        result.complete = result.complete || solved == total;
+        result.nodes = _nodes;
+        return result;
+    }
+
+private:
+
+    //  negamax result of the position for player, within the null window (alpha, beta)
+    int solve(int alpha, int beta, int player, int ply) {
+        if ((++_nodes & 4095) == 0 && _clock_t::now() >= _deadline)
+            _stopped = true;
+
+        if (_stopped)
+            return WDL_DRAW;
+
+        //  the move just played won the game
+        if (_position.isWinner(3 - player))
+            return WDL_LOSS;
+
+        if (_position.getAvailableMoves() == 0)
+            return WDL_DRAW;
+
+        if (winsNow(player))
+            return WDL_WIN;
+
+        int lower = WDL_LOSS, upper = WDL_WIN;
+
+        if (_cache->probe(_position.hash, lower, upper)) {
+            if (lower >= beta)
+                return lower;
+            if (upper <= alpha)
+                return upper;
+        }
+
+        int best = WDL_LOSS;
+        int total = countCells(orderedMoves(player, ply));
+
+        for (int i = 0; i < total; i++) {
+            UndoRecord undo;
+
+            _position.makeMove(_ordered[ply][i], player, undo);
+            int value = -solve(-beta, -alpha, 3 - player, ply + 1);
+            _position.undoMove(undo);
+
+            if (_stopped)
+                return WDL_DRAW;
+
+            if (value > best) {
+                best = value;
+
+                if (best >= beta)
+                    break;
+            }
+        }
+
+        //  a fail-high proves a lower bound, a fail-low an upper bound
+        if (best >= beta)
+            lower = std::max(lower, best);
+        else
+            upper = std::min(upper, best);
+
+        _cache->store(_position.hash, lower, upper);
+        return best;
+    }
+
+    //  a square player can win right now completes a line of won squares
+    bool winsNow(int player) const {
+        int squares = getPos(_position.won[player - 1]) & _position.playable();
+
+        for (; squares; squares &= squares - 1) {
+            if (_position.info(__builtin_ctz(squares)).threats[player - 1])
+                return true;
+        }
+
+        return false;
+    }
+
+    //  fills _ordered[ply]: moves winning a square first, moves giving a free move last
+    _mask81_t orderedMoves(int player, int ply = 0) {
+        _mask81_t moves = _position.getAvailableMoves();
+        int open = SQUARE_FULL & ~_position.closed();
+        int count = 0;
+
+        for (int pass = 0; pass < 3; pass++) {
+            for (_mask81_t rest = moves; rest;) {
+                int cell = popCell(rest);
+                int s = cell / 9;
+                bool winsSquare = ((_position.info(s).threats[player - 1] >> (cell % 9)) & 1) != 0;
+                bool freeMove = ((open >> (cell % 9)) & 1) == 0 || (cell % 9 == s && winsSquare);
+                int tier = winsSquare ? (0) : (freeMove ? (2) : (1));
+
+                if (tier == pass)
+                    _ordered[ply][count++] = cell;
+            }
+        }
+
+        return moves;
+    }
+
+    Position _position;
+    WDLCache *_cache;
+    _time_t _deadline;
+    long _nodes;
+    bool _stopped;
+
+    int _ordered[MAX_PLY + 1][81];
+};
+
+
+/* monte carlo tree search */
+
+//  exploration constant of UCB1
+const float UCT_C = 1.4f;
+
+//  nodes in the pool; once it is full the tree stops growing, but playouts go on
+const int MCTS_NODES = 1 << 21;
+
+struct MCTSNode {
+    int firstChild;         //  children are contiguous in the pool; -1 until expanded
+    int visits;
+    float wins;             //  for the player who played move, a draw counts half
+    __int8_t move;          //  cell
+    __uint8_t childCount;   //  0 once expanded means the game is over
+};
+
+/**
+ * UCT search with random playouts, an alternative to minimax.
+ *
+ * The tree is kept between moves: the next search starts from the node reached
+ * by my move and the opponent's answer, if the tree has it.
+ */
+class MonteCarlo {
+
+public:
+
+    MonteCarlo() {
+        _botId = 0;
+        _hasTree = false;
+        _playouts = 0;
+        _verbose = false;
+        _searchMoves = ALL_CELLS;
+        _restrictedRoot = false;
+    }
+
+    //  a line on stderr per move, as Search::setVerbose
+    void setVerbose(bool verbose) {
+        _verbose = verbose;
+    }
+
+    //  the next search starts from an empty tree
+    void clear() {
+        _hasTree = false;
+    }
+
+    long playouts() const {
+        return _playouts;
+    }
+
+    //  runs playouts until the deadline and returns the most visited move (cell)
+    //  among searchMoves, e.g. without the moves proven to lose
+    int think(const Position &position, int botId, _time_t deadline, _mask81_t searchMoves = ALL_CELLS) {
+        _time_t start = _clock_t::now();
+
+        _searchMoves = searchMoves;
+        reuseTree(position, botId);
+        _restrictedRoot = searchMoves != ALL_CELLS;
+        _playouts = 0;
+
+        do {
+            for (int i = 0; i < 256; i++)
+                iterate();
+        } while (_clock_t::now() < deadline);
+
+        const MCTSNode &root = _nodes[0];
+        int best = -1;
+
+        for (int c = 0; c < root.childCount; c++) {
+            if (best < 0 || _nodes[root.firstChild + c].visits > _nodes[best].visits)
+                best = root.firstChild + c;
+        }
+
+        double seconds = std::chrono::duration<double>(_clock_t::now() - start).count();
+
+        if (best < 0)
+            return -1;
+
+        if (_verbose)
+            std::cerr << "mcts: " << _playouts << " playouts (" << (long) (_playouts / seconds) << "/s), "
+                      << _nodes.size() << " nodes, " << convertToCoord(_nodes[best].move).first << " "
+                      << convertToCoord(_nodes[best].move).second << " won " << _nodes[best].wins / _nodes[best].visits
+                      << std::endl;
+
+        return _nodes[best].move;
+    }
+
+private:
+
+    //  selection, expansion, playout and backpropagation of one playout
+    void iterate() {
+        Position position = _rootPosition;
+        int player = _botId;
+        int path[MAX_PLY + 1];
+        int length = 0;
+        int node = 0;
+
+        path[length++] = node;
+
+        for (;;) {
+            if (_nodes[node].firstChild < 0) {
+                //  a new leaf gets one playout before it is expanded
+                if (_nodes[node].visits == 0 && node != 0)
+                    break;
+
+                if (!expand(node, position))
+                    break;
+            }
+
+            if (_nodes[node].childCount == 0)
+                break;
+
+            node = select(node);
+            position.simulateMove(_nodes[node].move, player);
+            player = 3 - player;
+            path[length++] = node;
+        }
+
+        int winner = playout(position, player);
+        _playouts++;
+
+        //  the node at depth i was reached by a move of the bot if i is odd
+        for (int i = 0; i < length; i++) {
+            MCTSNode &n = _nodes[path[i]];
+            int mover = (i % 2 == 1) ? (_botId) : (3 - _botId);
+
+            n.visits++;
+            n.wins += (winner == mover) ? (1.0f) : ((winner == 0) ? (0.5f) : (0.0f));
+        }
+    }
+
+    //  the first unvisited child, else the best by UCB1
+    int select(int node) {
+        const MCTSNode &parent = _nodes[node];
+        float exploration = UCT_C * sqrtf(logf((float) parent.visits));
+        int best = parent.firstChild;
+        float bestValue = -1;
+
+        for (int c = parent.firstChild; c < parent.firstChild + parent.childCount; c++) {
+            const MCTSNode &child = _nodes[c];
+
+            if (child.visits == 0)
+                return c;
+
+            float value = child.wins / child.visits + exploration / sqrtf((float) child.visits);
+
+            if (value > bestValue) {
+                bestValue = value;
+                best = c;
+            }
+        }
+
+        return best;
+    }
+
+    //  adds a child per available move, at the root only the searchMoves; false if the pool is full
+    bool expand(int node, const Position &position) {
+        _mask81_t moves = position.getAvailableMoves();
+
+        if (node == 0 && (moves & _searchMoves) != 0)
+            moves &= _searchMoves;
+
+        if (_nodes.size() + countCells(moves) > (size_t) MCTS_NODES)
+            return false;
+
+        _nodes[node].firstChild = (int) _nodes.size();
+        _nodes[node].childCount = (__uint8_t) countCells(moves);
+
+        while (moves) {
+            MCTSNode child = {-1, 0, 0, (__int8_t) popCell(moves), 0};
+            _nodes.push_back(child);
+        }
+
+        return true;
+    }
+
+    //  random moves until the game ends; returns the winner, 0 for a draw
+    int playout(Position position, int player) {
+        for (;;) {
+            _mask81_t moves = position.getAvailableMoves();
+
+            if (moves == 0)
+                break;
+
+            position.simulateMove(randomCell(moves), player);
+            player = 3 - player;
+        }
+
+        return position.isWinner(1) ? (1) : (position.isWinner(2) ? (2) : (0));
+    }
+
+    //  uniform among the cells of moves
+    int randomCell(_mask81_t moves) {
+        __uint64_t half = (__uint64_t) moves;
+        int lowCount = __builtin_popcountll(half);
+        int n = (int) ((_random.next() >> 32) % countCells(moves));
+        int offset = 0;
+
+        if (n >= lowCount) {
+            n -= lowCount;
+            half = (__uint64_t) (moves >> 64);
+            offset = 64;
+        }
+
+        while (n--)
+            half &= half - 1;
+
+        return offset + __builtin_ctzll(half);
+    }
+
+    //  keeps the subtree of position, if the previous tree reached it in two moves;
+    //  a root expanded with other root moves than searchMoves is not kept
+    void reuseTree(const Position &position, int botId) {
+        int root = -1;
+
+        if (_hasTree && botId == _botId && _searchMoves == ALL_CELLS) {
+            if (_rootPosition.same(position) && !_restrictedRoot) {
+                root = 0;
+            }
+            else if (_nodes[0].firstChild >= 0) {
+                const MCTSNode &top = _nodes[0];
+
+                for (int c = top.firstChild; c < top.firstChild + top.childCount && root < 0; c++) {
+                    const MCTSNode &mine = _nodes[c];
+
+                    for (int g = mine.firstChild; g >= 0 && g < mine.firstChild + mine.childCount; g++) {
+                        Position next = _rootPosition;
+                        next.simulateMove(mine.move, botId);
+                        next.simulateMove(_nodes[g].move, 3 - botId);
+
+                        if (next.same(position)) {
+                            root = g;
+                            break;
+                        }
+                    }
+                }
+            }
+        }
+
+        if (root < 0) {
+            MCTSNode top = {-1, 0, 0, -1, 0};
+
+            _nodes.reserve(MCTS_NODES);
+            _nodes.clear();
+            _nodes.push_back(top);
+        }
+        else if (root > 0) {
+            reroot(root);
+        }
+
+        _rootPosition = position;
+        _botId = botId;
+        _hasTree = true;
+    }
+
+    //  copies the subtree of root to the front of a fresh pool
+    void reroot(int root) {
+        std::vector<MCTSNode> pool;
+        pool.reserve(MCTS_NODES);
+        pool.push_back(_nodes[root]);
+
+        for (size_t i = 0; i < pool.size(); i++) {
+            int first = pool[i].firstChild;
+
+            if (first < 0)
+                continue;
+
+            pool[i].firstChild = (int) pool.size();
+
+            for (int c = first; c < first + pool[i].childCount; c++)
+                pool.push_back(_nodes[c]);
+        }
+
+        _nodes.swap(pool);
+    }
+
+    std::vector<MCTSNode> _nodes;
+    Position _rootPosition;
+    int _botId;
+    bool _hasTree;
+
+    Random _random;
+    long _playouts;
+    bool _verbose;
+    _mask81_t _searchMoves;     //  root moves to choose from
+    bool _restrictedRoot;       //  the root of the tree was expanded with fewer moves
+};
+
+
+/* opening book */
+
+//  16 bytes per position; the file holds them sorted by key
+struct BookEntry {
+    __uint64_t key;         //  zobrist key of the position
+    __int32_t score;        //  for the side to move, clamped
+    __uint8_t move;         //  cell
+    __uint8_t depth;
+    __uint16_t reserved;
+};
+
+struct BookHeader {
+    char magic[8];          //  "UTTTBOOK"
+    __uint32_t version;
+    __uint32_t count;
+    __uint64_t keyCheck;    //  zobristSide of the build that wrote it: other keys, other book
+};
+
+const __uint32_t BOOK_VERSION = 1;
+
+//  looked for in the working directory when the bot starts
+const char DEFAULT_BOOK[] = "uttt_book.bin";
+
+/**
+ * Book file mapped into memory as it is, so opening it parses nothing
+ * and a probe is a binary search over the mapped entries.
+ */
+class OpeningBook {
+
+public:
+
+    OpeningBook() {
+        _map = NULL;
+        _size = 0;
+        _entries = NULL;
+        _count = 0;
+    }
+
+    ~OpeningBook() {
+        close();
+    }
+
+    //  false if the file is missing or was written for other keys
+    bool open(const std::string &path);
+
+    void close();
+
+    size_t size() const {
+        return _count;
+    }
+
+    //  book move (cell) of position, or -1
+    int probe(const Position &position) const;
+
+    //  sorts entries by key and writes them as a book file
+    static bool write(const std::string &path, std::vector<BookEntry> entries);
+
+private:
+
+    OpeningBook(const OpeningBook &);
+    OpeningBook &operator=(const OpeningBook &);
+
+    void *_map;
+    size_t _size;
+    const BookEntry *_entries;
+    size_t _count;
+};
+
+
+/* benchmark */
+
+const int BENCH_DEPTH = 9;
+
+struct BenchPosition {
+    const char *field;
+    const char *macroboard;
+    int player;             //  side to move
+};
+
+//  positions from self-play games, each searched by the benchmark
+extern const BenchPosition benchPositions[];
+extern const int BENCH_POSITIONS;
+
+Position benchPosition(const BenchPosition &bench);
+
+//  searches every benchmark position to a fixed depth with one thread and an empty table;
+//  the total node count is a signature of the search, which only changes if its behaviour does
+void bench(int depth);
+
+//  time to depth of the parallel search on the benchmark positions, for 1, 2, 4 and 8 threads
+//  as far as the cores allow
+void smpBench(int depth);
+
+
+/* perft */
+
+//  leaf count below each root move, the root moves shared out between all cores
+std::vector<std::pair<int, __uint64_t> > perftDivide(const Position &position, int depth, bool hashed);
+
+//  uttt_perft <depth> [divide] [hash] [field macroboard], from the start position by default
+void perftCommand(int depth, bool divided, bool hashed, const std::string &field, const std::string &macroboard);
+
+
+/* batch analysis */
+
+struct AnalysisOptions {
+    int depth;              //  iterations, capped by the empty cells
+    long nodes;             //  node budget per position, 0 for none
+    int threads;
+    int hashMb;             //  per thread
+};
+
+//  lines read ahead of the workers, which bounds the memory on any input size
+const int ANALYSIS_QUEUE = 4096;
+
+//  reads one position per line, as "field macroboard" in the server's format, and writes
+//  "<line>: <x> <y> <score> <depth> <nodes> pv <x,y>..." as soon as each one is searched,
+//  so the output is not in input order. The side to move is the one with fewer cells
+void analyze(std::istream &in, std::ostream &out, const AnalysisOptions &options);
+
+#endif
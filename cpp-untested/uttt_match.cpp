@@ -0,0 +1,654 @@
+/*******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 Abdulla Gaibullaev
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ ******************************************************************************/
+
+#include "uttt_bot.h"
+
+#include <mutex>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+/**
+ * Self-play between two engine configurations, one game per worker thread.
+ *
+ *      uttt_match [-games N] [-concurrency N] [-tc timebank/time_per_move] [-openings plies]
+ *                 [-seed N] [-sprt elo0 elo1 alpha beta] [-hash MB] [-a settings | -acmd command]
+ *                 [-b settings | -bcmd command] [-record file]
+ *
+ * Settings are comma separated protocol settings, e.g. engine=mcts,depth=8,threads=1.
+ * A command runs an external bot over the protocol instead, e.g. an older build.
+ * Results are from A's point of view. -record appends every position the games reach
+ * to the file, as "<field> <macroboard> <winner>" with winner 0 for a draw: the
+ * training data of uttt_tune.
+ *
+ * Every worker runs two bots, so the in-process ones get a small transposition table
+ * and WDL cache, -hash MB each (default 4), and there are at most 4 workers unless
+ * -concurrency says otherwise; hash_mb and wdl_mb in the settings still override -hash.
+ *
+ * The exit status is 1 if a game was lost by an illegal move, a bug of one of the bots.
+ * The in-process engine never ponders; a command (e.g. -bcmd ./uttt_bot) plays with
+ * the bot's defaults, ponder included.
+ */
+
+
+/* protocol strings */
+
+//  81 values, row by row, as in the field update
+std::string fieldString(const Position &position) {
+    std::string field;
+
+    for (int i = 0; i < 81; i++) {
+        _mask81_t cell = cellMask(convertToInt(_move_t(i % 9, i / 9)));
+
+        if (i > 0)
+            field += ',';
+        field += (position.cells[0] & cell) ? ('1') : ((position.cells[1] & cell) ? ('2') : ('0'));
+    }
+
+    return field;
+}
+
+//  -1 for the squares that may be played, else the owner of the square or 0
+std::string macroboardString(const Position &position) {
+    std::string macroboard;
+
+    for (int s = 0; s < 9; s++) {
+        if (s > 0)
+            macroboard += ',';
+
+        if ((position.active & ~position.closed()) & (1 << s))
+            macroboard += "-1";
+        else
+            macroboard += ((position.won[0] >> s) & 1) ? ('1') : (((position.won[1] >> s) & 1) ? ('2') : ('0'));
+    }
+
+    return macroboard;
+}
+
+typedef std::vector<std::pair<std::string, std::string> > _settings_t;
+
+//  "key=value,key=value"
+_settings_t parseSettings(const std::string &s) {
+    std::vector<std::string> items;
+    _settings_t settings;
+
+    for (const std::string &item : split(s, ',', items)) {
+        size_t equals = item.find('=');
+
+        if (equals != std::string::npos)
+            settings.push_back(std::make_pair(item.substr(0, equals), item.substr(equals + 1)));
+    }
+
+    return settings;
+}
+
+
+/* players */
+
+struct TimeControl {
+    int timebank;
+    int timePerMove;
+};
+
+//  one side of a game, as the game server sees it
+class Player {
+
+public:
+
+    virtual ~Player() {
+    }
+
+    virtual void newGame(int botId, const TimeControl &tc) = 0;
+
+    //  sends the updates and the action; returns the move (cell), or -1 if there is none
+    virtual int action(const Position &position, int move, int time) = 0;
+
+    virtual void endGame() {
+    }
+};
+
+//  the engine itself, in this process
+class EnginePlayer : public Player {
+
+public:
+
+    EnginePlayer(const _settings_t &settings, int hashMb) {
+        _settings = settings;
+        _bot.setting("hash_mb", std::to_string(hashMb));
+        _bot.setting("wdl_mb", std::to_string(hashMb));
+    }
+
+    void newGame(int botId, const TimeControl &tc) {
+        _bot.newGame();
+
+        //  the opponent's search would share the cores with a ponder search,
+        //  and the bot's log would be mixed into the report
+        _bot.setting("ponder", "0");
+        _bot.setting("verbose", "0");
+        _bot.setting("timebank", std::to_string(tc.timebank));
+        _bot.setting("time_per_move", std::to_string(tc.timePerMove));
+        _bot.setting("player_names", "player1,player2");
+        _bot.setting("your_bot", "player" + std::to_string(botId));
+        _bot.setting("your_botid", std::to_string(botId));
+
+        for (const std::pair<std::string, std::string> &setting : _settings)
+            _bot.setting(setting.first, setting.second);
+    }
+
+    int action(const Position &position, int move, int time) {
+        _bot.update("game", "round", std::to_string((move + 1) / 2));
+        _bot.update("game", "move", std::to_string(move));
+        _bot.update("game", "field", fieldString(position));
+        _bot.update("game", "macroboard", macroboardString(position));
+
+        int cell = convertToInt(_bot.action("move", time));
+        _bot.startPonder(cell);
+
+        return cell;
+    }
+
+    void endGame() {
+        _bot.stopPonder();
+    }
+
+private:
+
+    Bot _bot;
+    _settings_t _settings;
+};
+
+//  a bot binary started for every game, talking the protocol over pipes
+class ProcessPlayer : public Player {
+
+public:
+
+    ProcessPlayer(const std::string &command, const _settings_t &settings) {
+        _command = command;
+        _settings = settings;
+        _pid = -1;
+        _in = _out = NULL;
+    }
+
+    ~ProcessPlayer() {
+        endGame();
+    }
+
+    void newGame(int botId, const TimeControl &tc) {
+        endGame();
+
+        //  close-on-exec, so no other game's bot inherits this one's pipes
+        int toBot[2], fromBot[2];
+        if (pipe2(toBot, O_CLOEXEC) != 0 || pipe2(fromBot, O_CLOEXEC) != 0)
+            return;
+
+        _pid = fork();
+
+        if (_pid == 0) {
+            int null = open("/dev/null", O_WRONLY);
+
+            dup2(toBot[0], 0);
+            dup2(fromBot[1], 1);
+            dup2(null, 2);
+            execl("/bin/sh", "sh", "-c", _command.c_str(), (char *) NULL);
+            _exit(127);
+        }
+
+        close(toBot[0]);
+        close(fromBot[1]);
+        _out = fdopen(toBot[1], "w");
+        _in = fdopen(fromBot[0], "r");
+
+        send("settings timebank " + std::to_string(tc.timebank));
+        send("settings time_per_move " + std::to_string(tc.timePerMove));
+        send("settings player_names player1,player2");
+        send("settings your_bot player" + std::to_string(botId));
+        send("settings your_botid " + std::to_string(botId));
+
+        for (const std::pair<std::string, std::string> &setting : _settings)
+            send("settings " + setting.first + " " + setting.second);
+    }
+
+    int action(const Position &position, int move, int time) {
+        if (_in == NULL)
+            return -1;
+
+        send("update game round " + std::to_string((move + 1) / 2));
+        send("update game move " + std::to_string(move));
+        send("update game field " + fieldString(position));
+        send("update game macroboard " + macroboardString(position));
+        send("action move " + std::to_string(time));
+        fflush(_out);
+
+        char line[256];
+        int x, y;
+
+        while (fgets(line, sizeof(line), _in) != NULL) {
+            if (sscanf(line, "place_move %d %d", &x, &y) == 2)
+                return (x >= 0 && x < 9 && y >= 0 && y < 9) ? (convertToInt(_move_t(x, y))) : (-1);
+        }
+
+        return -1;
+    }
+
+    //  the bot exits once its input is closed
+    void endGame() {
+        if (_out != NULL)
+            fclose(_out);
+        if (_in != NULL)
+            fclose(_in);
+        if (_pid > 0)
+            waitpid(_pid, NULL, 0);
+
+        _pid = -1;
+        _in = _out = NULL;
+    }
+
+private:
+
+    void send(const std::string &line) {
+        fputs(line.c_str(), _out);
+        fputc('\n', _out);
+    }
+
+    std::string _command;
+    _settings_t _settings;
+    pid_t _pid;
+    FILE *_in;
+    FILE *_out;
+};
+
+struct PlayerSpec {
+    std::string name;
+    std::string command;    //  empty for the engine in this process
+    _settings_t settings;
+};
+
+Player *createPlayer(const PlayerSpec &spec, int hashMb) {
+    if (spec.command.empty())
+        return new EnginePlayer(spec.settings, hashMb);
+
+    return new ProcessPlayer(spec.command, spec.settings);
+}
+
+
+/* games */
+
+//  plies random moves from the start position, in a game that is not over yet;
+//  seeded per opening so a match can be replayed
+Position randomOpening(int plies, __uint64_t seed) {
+    Random random(seed);
+    Position position;
+
+    for (;;) {
+        position.clear();
+
+        for (int ply = 0; ply < plies && !position.gameIsFinished(); ply++) {
+            _mask81_t moves = position.getAvailableMoves();
+
+            for (int n = (int) (random.next() % countCells(moves)); n > 0; n--)
+                popCell(moves);
+
+            position.simulateMove(popCell(moves), position.sideToMove());
+        }
+
+        if (!position.gameIsFinished())
+            return position;
+    }
+}
+
+struct GameResult {
+    int winner;             //  0 for a draw
+    int moves;
+    std::string reason;
+    std::vector<std::string> positions;     //  "<field> <macroboard>" before each move, if recorded
+};
+
+//  players[0] moves first; a player who plays an illegal move or overdraws the timebank loses
+GameResult playGame(Player *players[2], const Position &opening, const TimeControl &tc, bool recorded) {
+    Position position = opening;
+    int time[2] = {tc.timebank, tc.timebank};
+    int move = 81 - position.emptyCells() + 1;
+
+    players[0]->newGame(1, tc);
+    players[1]->newGame(2, tc);
+
+    GameResult result = {0, 0, "draw", std::vector<std::string>()};
+
+    for (;; move++) {
+        if (position.isWinner(1) || position.isWinner(2)) {
+            result.winner = position.isWinner(1) ? (1) : (2);
+            result.reason = "win";
+            break;
+        }
+
+        _mask81_t moves = position.getAvailableMoves();
+        if (moves == 0)
+            break;
+
+        if (recorded)
+            result.positions.push_back(fieldString(position) + " " + macroboardString(position));
+
+        int player = position.sideToMove();
+        _time_t start = _clock_t::now();
+        int cell = players[player - 1]->action(position, move, time[player - 1]);
+        int elapsed = (int) std::chrono::duration_cast<std::chrono::milliseconds>(_clock_t::now() - start).count();
+
+        time[player - 1] -= elapsed;
+
+        if (cell < 0 || cell >= 81 || (moves & cellMask(cell)) == 0 || time[player - 1] < 0) {
+            result.winner = 3 - player;
+            result.reason = (time[player - 1] < 0) ? ("time forfeit") : ("illegal move");
+            break;
+        }
+
+        time[player - 1] = std::min(tc.timebank, time[player - 1] + tc.timePerMove);
+        position.simulateMove(cell, player);
+    }
+
+    players[0]->endGame();
+    players[1]->endGame();
+
+    result.moves = move - 1;
+    return result;
+}
+
+
+/* statistics */
+
+//  expected score for an Elo difference
+double eloScore(double elo) {
+    return 1 / (1 + pow(10, -elo / 400));
+}
+
+double scoreElo(double score) {
+    score = std::min(std::max(score, 1e-6), 1 - 1e-6);
+    return -400 * log10(1 / score - 1);
+}
+
+struct MatchStats {
+    int wins;
+    int draws;
+    int losses;
+
+    int games() const {
+        return wins + draws + losses;
+    }
+
+    double score() const {
+        return (wins + 0.5 * draws) / games();
+    }
+
+    //  variance of one game's score
+    double variance() const {
+        double s = score();
+
+        return (wins * (1 - s) * (1 - s) + draws * (0.5 - s) * (0.5 - s) + losses * s * s) / games();
+    }
+
+    //  half width of the 95% confidence interval, in Elo
+    double eloMargin() const {
+        double deviation = 1.959964 * sqrt(variance() / games());
+
+        return (scoreElo(score() + deviation) - scoreElo(score() - deviation)) / 2;
+    }
+
+    //  log-likelihood ratio of elo1 against elo0, with the scores taken as normally distributed
+    double llr(double elo0, double elo1) const {
+        double s0 = eloScore(elo0), s1 = eloScore(elo1);
+
+        if (variance() <= 0)
+            return 0;
+
+        return games() * (s1 - s0) * (2 * score() - s0 - s1) / (2 * variance());
+    }
+};
+
+struct SPRT {
+    bool enabled;
+    double elo0, elo1;
+    double alpha, beta;
+
+    double lower() const {
+        return log(beta / (1 - alpha));
+    }
+
+    double upper() const {
+        return log((1 - beta) / alpha);
+    }
+};
+
+
+/* match */
+
+struct MatchOptions {
+    int games;
+    int concurrency;
+    int hashMb;             //  of each table of an in-process bot
+    int openingPlies;
+    __uint64_t seed;
+    TimeControl tc;
+    SPRT sprt;
+    PlayerSpec players[2];
+    std::string record;     //  file of the positions, none if empty
+};
+
+class Match {
+
+public:
+
+    explicit Match(const MatchOptions &options) : _options(options) {
+        _stats.wins = _stats.draws = _stats.losses = 0;
+        _nextGame = 0;
+        _stop = false;
+        _illegalMoves = 0;
+
+        if (!options.record.empty())
+            _record.open(options.record.c_str(), std::ios::app);
+    }
+
+    //  false if a game was lost by an illegal move
+    bool run() {
+        if (!_options.record.empty() && !_record.is_open()) {
+            std::cout << "cannot write " << _options.record << std::endl;
+            return false;
+        }
+
+        std::vector<std::thread> workers;
+
+        for (int i = 0; i < _options.concurrency; i++)
+            workers.push_back(std::thread(&Match::work, this));
+
+        for (std::thread &worker : workers)
+            worker.join();
+
+        report();
+
+        if (_illegalMoves > 0)
+            std::cout << _illegalMoves << " games lost by an illegal move" << std::endl;
+
+        return _illegalMoves == 0;
+    }
+
+private:
+
+    //  every pair of games plays one opening, with A moving first in the even game
+    void work() {
+        std::unique_ptr<Player> a(createPlayer(_options.players[0], _options.hashMb));
+        std::unique_ptr<Player> b(createPlayer(_options.players[1], _options.hashMb));
+
+        for (int game = _nextGame++; game < _options.games && !_stop; game = _nextGame++) {
+            bool aFirst = game % 2 == 0;
+            Player *players[2] = {aFirst ? a.get() : b.get(), aFirst ? b.get() : a.get()};
+
+            Position opening = randomOpening(_options.openingPlies, _options.seed + game / 2 + 1);
+            GameResult result = playGame(players, opening, _options.tc, _record.is_open());
+
+            finish(game, aFirst, result);
+        }
+    }
+
+    void finish(int game, bool aFirst, const GameResult &result) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        int aId = aFirst ? 1 : 2;
+
+        if (result.winner == 0)
+            _stats.draws++;
+        else if (result.winner == aId)
+            _stats.wins++;
+        else
+            _stats.losses++;
+
+        if (result.reason == "illegal move")
+            _illegalMoves++;
+
+        //  a forfeit says nothing about the positions
+        if (result.reason == "win" || result.reason == "draw") {
+            for (const std::string &position : result.positions)
+                _record << position << " " << result.winner << "\n";
+        }
+
+        std::cout << "game " << game + 1 << ": " << name(aFirst) << " vs " << name(!aFirst) << ": "
+                  << ((result.winner == 0) ? ("1/2-1/2") : ((result.winner == 1) ? ("1-0") : ("0-1")))
+                  << " (" << result.reason << ", " << result.moves << " moves)" << std::endl;
+        std::cout << "score of A vs B: " << _stats.wins << " - " << _stats.losses << " - " << _stats.draws
+                  << " [" << _stats.score() << "] " << _stats.games() << std::endl;
+
+        if (_stats.games() % 10 == 0)
+            report();
+
+        if (_options.sprt.enabled && !_stop) {
+            double llr = _stats.llr(_options.sprt.elo0, _options.sprt.elo1);
+
+            if (llr >= _options.sprt.upper() || llr <= _options.sprt.lower()) {
+                std::cout << "SPRT: H" << ((llr >= _options.sprt.upper()) ? (1) : (0)) << " accepted" << std::endl;
+                _stop = true;
+            }
+        }
+    }
+
+    void report() {
+        if (_stats.games() == 0)
+            return;
+
+        std::cout << "elo difference: " << scoreElo(_stats.score()) << " +/- " << _stats.eloMargin() << std::endl;
+
+        if (_options.sprt.enabled)
+            std::cout << "SPRT: llr " << _stats.llr(_options.sprt.elo0, _options.sprt.elo1) << " ("
+                      << _options.sprt.lower() << ", " << _options.sprt.upper() << "), elo0 " << _options.sprt.elo0
+                      << ", elo1 " << _options.sprt.elo1 << std::endl;
+    }
+
+    std::string name(bool a) const {
+        return a ? "A" : "B";
+    }
+
+    MatchOptions _options;
+    MatchStats _stats;
+    std::mutex _mutex;
+    std::atomic<int> _nextGame;
+    std::atomic<bool> _stop;
+    std::ofstream _record;
+    int _illegalMoves;
+};
+
+
+int main(int argc, char **argv) {
+    initEngine();
+
+    //  a bot that exits early must not take the match down
+    signal(SIGPIPE, SIG_IGN);
+
+    MatchOptions options;
+    options.games = 100;
+    options.concurrency = std::max(1, std::min(4, (int) std::thread::hardware_concurrency()));
+    options.hashMb = 4;
+    options.openingPlies = 4;
+    options.seed = 1;
+    options.tc.timebank = 10000;
+    options.tc.timePerMove = 500;
+    options.sprt.enabled = false;
+    options.players[0].name = options.players[1].name = "engine";
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool more = i + 1 < argc;
+
+        if (arg == "-games" && more) {
+            options.games = stringToInt(argv[++i]);
+        }
+        else if (arg == "-concurrency" && more) {
+            options.concurrency = std::max(1, stringToInt(argv[++i]));
+        }
+        else if (arg == "-hash" && more) {
+            options.hashMb = std::max(1, stringToInt(argv[++i]));
+        }
+        else if (arg == "-openings" && more) {
+            options.openingPlies = std::max(0, stringToInt(argv[++i]));
+        }
+        else if (arg == "-seed" && more) {
+            options.seed = (__uint64_t) atoll(argv[++i]);
+        }
+        else if (arg == "-tc" && more) {
+            std::string tc = argv[++i];
+            size_t slash = tc.find('/');
+
+            options.tc.timebank = stringToInt(tc.substr(0, slash));
+            options.tc.timePerMove = (slash != std::string::npos) ? (stringToInt(tc.substr(slash + 1))) : (0);
+        }
+        else if (arg == "-sprt" && i + 4 < argc) {
+            options.sprt.enabled = true;
+            options.sprt.elo0 = atof(argv[++i]);
+            options.sprt.elo1 = atof(argv[++i]);
+            options.sprt.alpha = atof(argv[++i]);
+            options.sprt.beta = atof(argv[++i]);
+        }
+        else if ((arg == "-a" || arg == "-b") && more) {
+            PlayerSpec &spec = options.players[arg == "-a" ? 0 : 1];
+
+            spec.name = argv[++i];
+            spec.settings = parseSettings(spec.name);
+        }
+        else if ((arg == "-acmd" || arg == "-bcmd") && more) {
+            PlayerSpec &spec = options.players[arg == "-acmd" ? 0 : 1];
+
+            spec.command = spec.name = argv[++i];
+        }
+        else if (arg == "-record" && more) {
+            options.record = argv[++i];
+        }
+        else {
+            std::cerr << "unknown option " << arg << std::endl;
+            return 1;
+        }
+    }
+
+    std::cout << "A: " << options.players[0].name << std::endl
+              << "B: " << options.players[1].name << std::endl
+              << options.games << " games, " << options.concurrency << " workers, tc " << options.tc.timebank
+              << "/" << options.tc.timePerMove << ", " << options.openingPlies << " random plies" << std::endl;
+
+    return Match(options).run() ? 0 : 1;
+}
@@ -0,0 +1,57 @@
+/*******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 Abdulla Gaibullaev
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ ******************************************************************************/
+
+#include "uttt_engine.h"
+
+/**
+ * Move generator check: counts the leaves of the game tree.
+ *
+ *      uttt_perft <depth> [divide] [hash] [field macroboard]
+ *
+ * From the start position unless a position is given in the format of the
+ * engine's update messages; divide prints the count below each root move.
+ * The known counts are checked by uttt_test_perft.
+ */
+
+int main(int argc, char **argv) {
+    initEngine();
+
+    bool divided = false, hashed = false;
+    std::vector<std::string> position;
+
+    for (int i = 2; i < argc; i++) {
+        std::string arg = argv[i];
+
+        if (arg == "divide")
+            divided = true;
+        else if (arg == "hash")
+            hashed = true;
+        else
+            position.push_back(arg);
+    }
+
+    perftCommand(argc > 1 ? stringToInt(argv[1]) : 1, divided, hashed,
+                 position.size() == 2 ? position[0] : "", position.size() == 2 ? position[1] : "");
+    return 0;
+}
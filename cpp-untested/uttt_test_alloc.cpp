@@ -0,0 +1,86 @@
+/*******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 Abdulla Gaibullaev
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ ******************************************************************************/
+
+#include "uttt_engine.h"
+
+#include <new>
+
+/**
+ * The search must not allocate once its Search exists.
+ *
+ *      uttt_test_alloc [depth]
+ *
+ * Searches every benchmark position to depth twice with the same Search, and
+ * counts the heap allocations of the second search, which must be none.
+ * The counting operator new lives here only, not in the bot.
+ */
+
+//  every heap allocation of this program
+std::atomic<long> allocations(0);
+
+void *operator new(size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+
+    void *p = malloc(size > 0 ? size : 1);
+    if (p == NULL)
+        throw std::bad_alloc();
+
+    return p;
+}
+
+void operator delete(void *p) noexcept {
+    free(p);
+}
+
+bool allocVerify(int depth) {
+    TranspositionTable tt;
+    long total = 0;
+
+    for (int i = 0; i < BENCH_POSITIONS; i++) {
+        const BenchPosition &bench = benchPositions[i];
+        Position position = benchPosition(bench);
+        Search search(position, bench.player, &tt);
+        _score_t score;
+
+        tt.clear();
+        search.think(std::min(depth, position.emptyCells()), _time_t::max(), score);
+
+        long before = allocations.load();
+        search.think(std::min(depth, position.emptyCells()), _time_t::max(), score);
+        long counted = allocations.load() - before;
+
+        total += counted;
+        std::cout << "position " << i + 1 << "/" << BENCH_POSITIONS << ": " << search.nodes() << " nodes, "
+                  << counted << " allocations" << std::endl;
+    }
+
+    std::cout << (total == 0 ? "no allocations in the search" : "the search allocates") << std::endl;
+    return total == 0;
+}
+
+int main(int argc, char **argv) {
+    initEngine();
+
+    return allocVerify(argc > 1 ? stringToInt(argv[1]) : BENCH_DEPTH) ? 0 : 1;
+}
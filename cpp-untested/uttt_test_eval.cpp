@@ -0,0 +1,117 @@
+/*******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 Abdulla Gaibullaev
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ ******************************************************************************/
+
+#include "uttt_engine.h"
+
+/**
+ * The vector evaluators against the scalar one.
+ *
+ *      uttt_test_eval
+ *
+ * Compares every evaluator this cpu runs with the scalar one on positions of
+ * random games, and prints the speed of each.
+ */
+
+//  false on any difference
+bool evalVerify() {
+    const int GAMES = 20000;
+    const int REPEAT = 20;
+    std::vector<__int32_t> inputs;
+    Random random;
+
+    //  the square values of both players at every position of random games
+    for (int game = 0; game < GAMES; game++) {
+        Position position;
+        position.clear();
+
+        for (int player = 1; !position.gameIsFinished(); player = (player == 1) ? (2) : (1)) {
+            __int32_t squares[2][9];
+            position.squareValues(player, squares[0]);
+            position.squareValues((player == 1) ? (2) : (1), squares[1]);
+            inputs.insert(inputs.end(), &squares[0][0], &squares[0][0] + 18);
+
+            _mask81_t moves = position.getAvailableMoves();
+
+            for (int skip = (int) (random.next() % countCells(moves)); skip > 0; skip--)
+                moves &= moves - 1;
+
+            position.simulateMove(popCell(moves), player);
+        }
+    }
+
+    //  the extremes: every square won by one side or the other
+    for (int mask = 0; mask < (1 << 9); mask++) {
+        for (int s = 0; s < 18; s++)
+            inputs.push_back(((mask >> (s % 9)) & 1) == (s / 9) ? (0) : (MICRO_WIN_SCORE));
+    }
+
+    size_t count = inputs.size() / 18;
+    const __int32_t (*positions)[2][9] = (const __int32_t (*)[2][9]) inputs.data();
+    std::vector<_score_t> expected(count);
+
+    for (size_t i = 0; i < count; i++)
+        expected[i] = evaluateLinesScalar(positions[i]);
+
+    const char *previous = evaluatorName();
+    bool passed = true;
+
+    std::cout << count << " positions" << std::endl;
+
+    for (const char *name : {"scalar", "sse4", "avx2"}) {
+        if (!selectEvaluator(name)) {
+            std::cout << name << ": not supported by this cpu" << std::endl;
+            continue;
+        }
+
+        size_t mismatches = 0;
+        for (size_t i = 0; i < count; i++)
+            mismatches += evaluateLines(positions[i]) != expected[i];
+
+        _score_t checksum = 0;
+        _time_t start = _clock_t::now();
+
+        for (int r = 0; r < REPEAT; r++) {
+            for (size_t i = 0; i < count; i++)
+                checksum += evaluateLines(positions[i]);
+        }
+
+        double seconds = std::chrono::duration<double>(_clock_t::now() - start).count();
+        passed = passed && mismatches == 0;
+
+        std::cout << name << ": " << (mismatches == 0 ? "identical" : "DIFFERS") << " (" << mismatches
+                  << " mismatches), " << (long) (REPEAT * count / std::max(seconds, 1e-9)) << " evals/second"
+                  << " [" << checksum << "]" << std::endl;
+    }
+
+    selectEvaluator(previous);
+
+    std::cout << (passed ? "all evaluators match" : "evaluators differ") << std::endl;
+    return passed;
+}
+
+int main() {
+    initEngine();
+
+    return evalVerify() ? 0 : 1;
+}
@@ -0,0 +1,104 @@
+/*******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 Abdulla Gaibullaev
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ ******************************************************************************/
+
+#include "uttt_engine.h"
+
+/**
+ * The move generator against known leaf counts.
+ *
+ *      uttt_test_perft
+ *
+ * Runs every perft check with and without the table.
+ */
+
+struct PerftCheck {
+    const char *field;
+    const char *macroboard;
+    int depth;
+    __uint64_t count;
+};
+
+//  counts from an independent implementation of the rules; the positions cover forced
+//  and free moves, won and drawn squares, and games ending before the last ply
+const PerftCheck perftChecks[] = {
+        //  start position
+        {"0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0",
+         "-1,-1,-1,-1,-1,-1,-1,-1,-1", 5, 473256},
+        {"0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0",
+         "-1,-1,-1,-1,-1,-1,-1,-1,-1", 6, 4020960},
+        //  benchmark positions 1, 9, 13 and 30
+        {"0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,2,0,0,0,0,1,0,0,0,0,0,0",
+         "0,0,0,-1,0,0,0,0,0", 7, 3244756},
+        {"2,0,0,0,0,0,0,0,1,1,0,1,2,0,2,0,1,0,0,0,0,0,0,0,2,2,0,0,1,2,0,0,2,0,0,1,0,1,0,2,1,2,2,0,1,0,2,1,0,2,1,2,0,1,0,0,0,1,1,0,2,0,0,0,2,0,0,1,2,1,2,0,1,0,1,0,1,0,0,0,2",
+         "-1,-1,-1,-1,-1,1,-1,1,2", 6, 5735618},
+        {"2,1,0,2,1,0,0,0,1,1,1,1,2,1,2,0,1,0,1,0,0,2,0,0,2,2,0,2,1,2,2,2,2,0,0,1,0,1,0,2,1,2,2,0,1,0,2,1,0,2,1,2,0,1,2,0,0,1,1,0,2,0,0,0,2,0,0,1,2,1,2,0,1,1,1,0,1,0,0,0,2",
+         "1,2,-1,-1,2,1,1,1,2", 8, 2870},
+        {"0,1,1,1,1,2,0,0,0,2,0,2,2,2,1,2,0,0,2,2,0,0,2,0,1,1,1,1,1,0,2,1,0,2,2,0,1,1,2,0,2,1,2,1,1,0,1,0,0,0,0,2,0,0,0,0,2,1,2,0,1,2,2,0,0,1,2,0,0,0,0,0,1,0,2,0,1,2,0,0,1",
+         "-1,0,1,1,0,2,0,0,0", 7, 1778197},
+        //  random games, with drawn squares
+        {"0,1,0,0,2,1,0,0,0,2,0,0,2,2,2,2,2,2,1,2,1,2,0,1,2,1,0,1,0,0,2,1,1,0,0,0,1,1,0,1,1,2,1,1,0,1,1,2,2,2,1,0,1,1,1,1,2,0,1,1,2,0,0,2,2,0,2,1,2,2,2,0,0,1,1,2,2,1,1,2,2",
+         "-1,0,0,0,0,-1,-1,-1,0", 9, 183875},
+        {"0,1,1,2,0,0,2,0,0,1,2,1,1,1,1,2,0,1,0,1,0,0,0,0,2,1,2,2,2,1,2,1,2,2,0,1,1,1,2,2,1,2,2,1,0,1,2,1,1,2,1,2,0,0,1,2,2,0,0,1,0,2,1,0,1,2,2,2,1,2,2,1,1,2,2,2,0,1,1,1,2",
+         "-1,0,0,0,0,0,0,0,-1", 4, 4},
+        {"1,2,2,1,0,2,1,2,1,1,0,2,0,2,1,2,1,1,2,1,2,1,2,2,1,0,2,2,0,1,2,1,1,0,0,2,1,1,2,1,1,0,2,2,2,1,2,2,2,2,1,1,1,0,2,0,2,1,1,2,0,1,1,0,0,2,2,2,1,1,2,1,2,1,2,1,2,1,1,0,1",
+         "0,-1,0,0,-1,0,0,0,0", 3, 3},
+};
+
+//  false on any mismatch
+bool perftVerify() {
+    bool passed = true;
+    int index = 0;
+
+    for (const PerftCheck &check : perftChecks) {
+        Position position;
+
+        position.clear();
+        position.setField(check.field);
+        position.setMacroboard(check.macroboard);
+        index++;
+
+        for (int hashed = 0; hashed < 2; hashed++) {
+            __uint64_t total = 0;
+
+            for (const std::pair<int, __uint64_t> &move : perftDivide(position, check.depth, hashed != 0))
+                total += move.second;
+
+            bool ok = total == check.count;
+            passed = passed && ok;
+
+            std::cout << "check " << index << (hashed ? " hash" : "") << ": depth " << check.depth << ", "
+                      << total << (ok ? " ok" : " FAILED, expected ") << (ok ? "" : std::to_string(check.count))
+                      << std::endl;
+        }
+    }
+
+    std::cout << (passed ? "all perft counts match" : "perft counts differ") << std::endl;
+    return passed;
+}
+
+int main() {
+    initEngine();
+
+    return perftVerify() ? 0 : 1;
+}
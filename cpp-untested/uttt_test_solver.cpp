@@ -0,0 +1,172 @@
+/*******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 Abdulla Gaibullaev
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ ******************************************************************************/
+
+#include "uttt_engine.h"
+
+/**
+ * The solver against a plain negamax, and MCTS against the solver.
+ *
+ *      uttt_test_solver [positions] [empty cells]
+ *
+ * Plays random games to the given number of empty cells (default 20), then checks:
+ * the proven result of the root is the exact one, each move the solver calls losing
+ * loses, and without a win every losing move is found. MCTS, given the moves that
+ * are not proven to lose, must choose among them, with and without a tree to reuse,
+ * and given a single one of them, must play it.
+ */
+
+//  the exact result for player, the side to move, with no pruning but a found win
+int negamax(const Position &position, int player) {
+    if (position.isWinner(3 - player))
+        return WDL_LOSS;
+
+    _mask81_t moves = position.getAvailableMoves();
+    int best = WDL_LOSS;
+
+    if (moves == 0)
+        return WDL_DRAW;
+
+    while (moves != 0 && best < WDL_WIN) {
+        Position next = position;
+
+        next.simulateMove(popCell(moves), player);
+        best = std::max(best, -negamax(next, 3 - player));
+    }
+
+    return best;
+}
+
+//  a random game, stopped at empty cells, that is not over yet
+Position latePosition(Random &random, int empty) {
+    Position position;
+
+    for (;;) {
+        position.clear();
+
+        while (!position.gameIsFinished() && position.emptyCells() > empty) {
+            _mask81_t moves = position.getAvailableMoves();
+
+            for (int n = (int) (random.next() % countCells(moves)); n > 0; n--)
+                popCell(moves);
+
+            position.simulateMove(popCell(moves), position.sideToMove());
+        }
+
+        if (!position.gameIsFinished())
+            return position;
+    }
+}
+
+//  a short MCTS search of the side to move, among searchMoves
+int mctsChoice(MonteCarlo &mcts, const Position &position, _mask81_t searchMoves) {
+    return mcts.think(position, position.sideToMove(), _clock_t::now() + std::chrono::milliseconds(5), searchMoves);
+}
+
+bool solverVerify(int count, int empty) {
+    Random random;
+    WDLCache cache;
+    MonteCarlo mcts;
+    bool passed = true;
+
+    for (int index = 1; index <= count; index++) {
+        Position position = latePosition(random, empty);
+        int player = position.sideToMove();
+        _mask81_t moves = position.getAvailableMoves();
+
+        //  the exact result of every root move
+        int values[81];
+        int exact = WDL_LOSS;
+        _mask81_t losing = 0;
+
+        for (_mask81_t rest = moves; rest != 0; ) {
+            int cell = popCell(rest);
+            Position next = position;
+
+            next.simulateMove(cell, player);
+            values[cell] = -negamax(next, 3 - player);
+            exact = std::max(exact, values[cell]);
+
+            if (values[cell] == WDL_LOSS)
+                losing |= cellMask(cell);
+        }
+
+        cache.clear();
+        Solver solver(&cache);
+        SolverResult proven = solver.solveRoot(position, player, _time_t::max());
+
+        bool ok = proven.complete && proven.result == exact
+                  && (proven.move < 0 ? (exact == WDL_LOSS) : (values[proven.move] == exact))
+                  && (proven.losing & ~losing) == 0
+                  && (exact == WDL_WIN || proven.losing == losing);
+
+        std::cout << "position " << index << "/" << count << ": " << WDL_NAMES[exact + 1] << ", "
+                  << countCells(losing) << " of " << countCells(moves) << " moves lose"
+                  << (ok ? ("") : (", the solver is wrong")) << std::endl;
+
+        passed = passed && ok;
+
+        //  as the bot does: MCTS on the moves not proven to lose, when some are left
+        if ((moves & ~proven.losing) == 0 || countCells(moves) < 2)
+            continue;
+
+        //  from a fresh tree, after a tree of every move, and again restricted
+        mcts.clear();
+        int choices[3];
+        choices[0] = mctsChoice(mcts, position, ~proven.losing);
+        mctsChoice(mcts, position, ALL_CELLS);
+        choices[1] = mctsChoice(mcts, position, ~proven.losing);
+        choices[2] = mctsChoice(mcts, position, ~proven.losing);
+
+        for (int choice : choices) {
+            if (choice < 0 || !(moves & cellMask(choice)) || (proven.losing & cellMask(choice))) {
+                std::cout << "position " << index << ": MCTS chose " << choice << ", a move proven to lose"
+                          << std::endl;
+                passed = false;
+            }
+        }
+
+        //  the losing moves are rarely the most visited anyway: a single move must be the choice
+        for (_mask81_t rest = moves & ~proven.losing; rest != 0; ) {
+            int cell = popCell(rest);
+
+            mctsChoice(mcts, position, ALL_CELLS);
+            int choice = mctsChoice(mcts, position, cellMask(cell));
+
+            if (choice != cell) {
+                std::cout << "position " << index << ": MCTS chose " << choice << " instead of " << cell
+                          << ", the only move allowed" << std::endl;
+                passed = false;
+            }
+        }
+    }
+
+    std::cout << (passed ? "the solver is exact" : "the solver check failed") << std::endl;
+    return passed;
+}
+
+int main(int argc, char **argv) {
+    initEngine();
+
+    return solverVerify(argc > 1 ? stringToInt(argv[1]) : 24, argc > 2 ? stringToInt(argv[2]) : 20) ? 0 : 1;
+}
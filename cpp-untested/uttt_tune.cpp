@@ -0,0 +1,353 @@
+/*******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 Abdulla Gaibullaev
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ ******************************************************************************/
+
+#include "uttt_engine.h"
+
+#include <fstream>
+#include <iomanip>
+
+/**
+ * Texel tuning of the evaluation weights on recorded games.
+ *
+ *      uttt_tune [-threads T] [-passes N] [-out file] [file...]
+ *
+ * The positions are those of uttt_match -record, stdin by default, each labelled
+ * with the result of its game. The error of a set of weights is the mean squared
+ * difference between the results and sigmoid(scale * evaluation), the evaluation
+ * being the engine's own (its square values under those weights, then evaluateLines).
+ * The scale is fitted once to the current weights, since the evaluation has no unit.
+ *
+ * Then each weight in turn is moved up and down by its step, and the change is kept
+ * if the error decreases; a pass without any improvement halves the steps, down to 1.
+ * The weights that fit the evaluators are tried only (weightsFit). The result is
+ * written as uttt_weights.h.
+ */
+
+//  positions per batch handed to a thread
+const int TUNE_BATCH = 16384;
+
+//  a recorded position, as much as the evaluation needs
+struct Sample {
+    unsigned short states[9];   //  Position::state of each square
+    float result;               //  for the first player: 1, 1/2 or 0
+};
+
+//  "<field> <macroboard> <winner>" lines; returns false for a line that is not one
+bool parseSample(const std::string &line, Sample &sample) {
+    Token tokens[4];
+
+    if (tokenize(line.c_str(), ' ', tokens, 4) != 3 || tokens[2].length != 1 ||
+        tokens[2].begin[0] < '0' || tokens[2].begin[0] > '2')
+        return false;
+
+    Position position;
+    position.clear();
+    position.setField(tokens[0].begin);
+    position.setMacroboard(tokens[1].begin);
+
+    if (position.gameIsFinished())
+        return false;
+
+    for (int s = 0; s < 9; s++)
+        sample.states[s] = (unsigned short) position.state(s);
+
+    int winner = tokens[2].begin[0] - '0';
+    sample.result = (winner == 0) ? (0.5f) : ((winner == 1) ? (1.0f) : (0.0f));
+
+    return true;
+}
+
+void loadSamples(std::istream &in, std::vector<Sample> &samples) {
+    std::string line;
+    Sample sample;
+
+    while (std::getline(in, line)) {
+        if (!line.empty() && line[line.size() - 1] == '\r')
+            line.erase(line.size() - 1);
+
+        if (parseSample(line, sample))
+            samples.push_back(sample);
+    }
+}
+
+//  the evaluation of the sample for the first player
+inline _score_t evaluateSample(const Sample &sample, const SquareValueTable &table) {
+    __int32_t squares[2][9];
+
+    for (int s = 0; s < 9; s++) {
+        squares[0][s] = table.values[sample.states[s]][0];
+        squares[1][s] = table.values[sample.states[s]][1];
+    }
+
+    return evaluateLines(squares);
+}
+
+//  mean squared error of the predictions over all samples, the batches shared out between the threads
+double meanError(const std::vector<Sample> &samples, const SquareValueTable &table, double scale, int threads) {
+    std::atomic<size_t> next(0);
+    std::vector<double> sums(threads, 0.0);
+
+    auto worker = [&](int id) {
+        double sum = 0;
+
+        for (size_t first = next.fetch_add(TUNE_BATCH); first < samples.size(); first = next.fetch_add(TUNE_BATCH)) {
+            size_t last = std::min(samples.size(), first + TUNE_BATCH);
+
+            for (size_t i = first; i < last; i++) {
+                double predicted = 1 / (1 + exp(-scale * (double) evaluateSample(samples[i], table)));
+                double error = samples[i].result - predicted;
+
+                sum += error * error;
+            }
+        }
+
+        sums[id] = sum;
+    };
+
+    std::vector<std::thread> workers;
+    for (int i = 0; i < threads; i++)
+        workers.push_back(std::thread(worker, i));
+
+    for (std::thread &thread : workers)
+        thread.join();
+
+    double sum = 0;
+    for (double s : sums)
+        sum += s;
+
+    return sum / samples.size();
+}
+
+struct TuneOptions {
+    int threads;
+    int passes;             //  most passes over the weights
+    std::string out;
+};
+
+class Tuner {
+
+public:
+
+    Tuner(const std::vector<Sample> &samples, const TuneOptions &options) : _samples(samples), _options(options) {
+        _table.reset(new SquareValueTable());
+        _scale = 0;
+    }
+
+    double error(const EvalWeights &weights) {
+        _table->fill(weights);
+        return meanError(_samples, *_table, _scale, _options.threads);
+    }
+
+    //  golden section search of the scale on a log scale: the evaluation spans many orders
+    //  of magnitude, from a few line products to 8 * MICRO_WIN_SCORE^3
+    double fitScale(const EvalWeights &weights) {
+        const double ratio = (sqrt(5.0) - 1) / 2;
+        double low = -16, high = 0;
+
+        _table->fill(weights);
+
+        auto errorAt = [&](double exponent) {
+            return meanError(_samples, *_table, pow(10, exponent), _options.threads);
+        };
+
+        double a = high - ratio * (high - low), b = low + ratio * (high - low);
+        double errorA = errorAt(a), errorB = errorAt(b);
+
+        while (high - low > 0.001) {
+            if (errorA < errorB) {
+                high = b;
+                b = a;
+                errorB = errorA;
+                a = high - ratio * (high - low);
+                errorA = errorAt(a);
+            }
+            else {
+                low = a;
+                a = b;
+                errorA = errorB;
+                b = low + ratio * (high - low);
+                errorB = errorAt(b);
+            }
+        }
+
+        _scale = pow(10, (low + high) / 2);
+        return _scale;
+    }
+
+    //  local search from weights; returns the best weights found and their error
+    EvalWeights tune(EvalWeights weights, double &best) {
+        int EvalWeights::*members[] = {
+                &EvalWeights::cellEmpty, &EvalWeights::cellMine, &EvalWeights::cellTheirs, &EvalWeights::microWin
+        };
+        const char *names[] = {"CELL_SCORE_EMPTY", "CELL_SCORE_MINE", "CELL_SCORE_THEIRS", "MICRO_WIN_SCORE"};
+        int steps[4];
+
+        for (int k = 0; k < 4; k++)
+            steps[k] = std::max(1, weights.*members[k] / 2);
+
+        best = error(weights);
+
+        for (int pass = 1; pass <= _options.passes; pass++) {
+            bool improved = false;
+
+            for (int k = 0; k < 4; k++) {
+                for (int sign : {1, -1}) {
+                    EvalWeights candidate = weights;
+                    candidate.*members[k] += sign * steps[k];
+
+                    if (!weightsFit(candidate))
+                        continue;
+
+                    double e = error(candidate);
+
+                    if (e < best) {
+                        best = e;
+                        weights = candidate;
+                        improved = true;
+
+                        std::cout << "pass " << pass << ": " << names[k] << " " << weights.*members[k]
+                                  << ", error " << std::setprecision(8) << best << std::endl;
+                        break;
+                    }
+                }
+            }
+
+            if (!improved) {
+                if (*std::max_element(steps, steps + 4) == 1)
+                    break;
+
+                for (int &step : steps)
+                    step = std::max(1, step / 2);
+            }
+        }
+
+        return weights;
+    }
+
+private:
+
+    const std::vector<Sample> &_samples;
+    TuneOptions _options;
+    std::unique_ptr<SquareValueTable> _table;
+    double _scale;
+};
+
+//  the weights in the form of uttt_weights.h
+bool writeWeights(const std::string &path, const EvalWeights &weights, size_t samples, double error) {
+    std::ofstream out(path.c_str());
+
+    out << "#ifndef UTTT_WEIGHTS_H\n"
+        << "#define UTTT_WEIGHTS_H\n"
+        << "\n"
+        << "//  the weights of the evaluation, included by uttt_engine.h;\n"
+        << "//  written by uttt_tune from " << samples << " positions, mean squared error " << error << "\n"
+        << "\n"
+        << "//  value of a won square; a lost one is worth 0\n"
+        << "constexpr _score_t MICRO_WIN_SCORE = " << weights.microWin << ";\n"
+        << "\n"
+        << "//  line products of a square: every cell of a line multiplies it by one of these\n"
+        << "constexpr _score_t CELL_SCORE_EMPTY = " << weights.cellEmpty << ";\n"
+        << "constexpr _score_t CELL_SCORE_MINE = " << weights.cellMine << ";\n"
+        << "constexpr _score_t CELL_SCORE_THEIRS = " << weights.cellTheirs << ";\n"
+        << "\n"
+        << "#endif\n";
+
+    return (bool) out;
+}
+
+int main(int argc, char **argv) {
+    initEngine();
+
+    TuneOptions options;
+    options.threads = std::max(1, (int) std::thread::hardware_concurrency());
+    options.passes = 100;
+    options.out = "uttt_weights.h";
+    std::vector<std::string> paths;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool more = i + 1 < argc;
+
+        if (arg == "-threads" && more) {
+            options.threads = std::max(1, stringToInt(argv[++i]));
+        }
+        else if (arg == "-passes" && more) {
+            options.passes = std::max(0, stringToInt(argv[++i]));
+        }
+        else if (arg == "-out" && more) {
+            options.out = argv[++i];
+        }
+        else {
+            paths.push_back(arg);
+        }
+    }
+
+    std::vector<Sample> samples;
+    _time_t start = _clock_t::now();
+
+    if (paths.empty())
+        loadSamples(std::cin, samples);
+
+    for (const std::string &path : paths) {
+        std::ifstream file(path.c_str());
+
+        if (!file) {
+            std::cerr << "cannot read " << path << std::endl;
+            return 1;
+        }
+
+        loadSamples(file, samples);
+    }
+
+    if (samples.empty()) {
+        std::cerr << "no positions" << std::endl;
+        return 1;
+    }
+
+    std::cout << samples.size() << " positions, loaded in "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(_clock_t::now() - start).count() << " ms"
+              << std::endl;
+
+    Tuner tuner(samples, options);
+    start = _clock_t::now();
+
+    double scale = tuner.fitScale(ENGINE_WEIGHTS);
+    double error;
+
+    std::cout << "scale " << scale << ", error " << std::setprecision(8) << tuner.error(ENGINE_WEIGHTS) << std::endl;
+
+    EvalWeights weights = tuner.tune(ENGINE_WEIGHTS, error);
+
+    std::cout << "tuned in " << std::chrono::duration_cast<std::chrono::milliseconds>(_clock_t::now() - start).count()
+              << " ms: CELL_SCORE_EMPTY " << weights.cellEmpty << ", CELL_SCORE_MINE " << weights.cellMine
+              << ", CELL_SCORE_THEIRS " << weights.cellTheirs << ", MICRO_WIN_SCORE " << weights.microWin << std::endl;
+
+    if (!writeWeights(options.out, weights, samples.size(), error)) {
+        std::cerr << "cannot write " << options.out << std::endl;
+        return 1;
+    }
+
+    std::cout << "weights written to " << options.out << std::endl;
+    return 0;
+}